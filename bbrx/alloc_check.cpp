@@ -0,0 +1,49 @@
+#include <Arduino.h>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "alloc_check.h"
+#include "log.h"
+#include "config.h"
+
+#define LOG_TAG "alloc"
+
+#ifdef ALLOC_CHECK
+
+TaskHandle_t alloc_check_task = nullptr;        // task whose allocations are being counted (nullptr = none)
+uint32_t alloc_check_count = 0;                 // number of allocations made by alloc_check_task since alloc_check_begin() (only written by that task)
+
+/**
+ * @brief Allocate memory for operator new, counting it if it was made by the task being checked
+ */
+static void *alloc_check_malloc(size_t size) {
+    if (alloc_check_task != nullptr && xTaskGetCurrentTaskHandle() == alloc_check_task) alloc_check_count++;
+    return malloc(size ? size : 1);
+}
+
+// exceptions are disabled, so running out of memory can't throw std::bad_alloc
+void *operator new(size_t size)                                   { void *p = alloc_check_malloc(size); if (p == nullptr) abort(); return p; }
+void *operator new[](size_t size)                                 { void *p = alloc_check_malloc(size); if (p == nullptr) abort(); return p; }
+void *operator new(size_t size, const std::nothrow_t &) noexcept   { return alloc_check_malloc(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return alloc_check_malloc(size); }
+void operator delete(void *p) noexcept                            { free(p); }
+void operator delete[](void *p) noexcept                          { free(p); }
+void operator delete(void *p, size_t) noexcept                    { free(p); }
+void operator delete[](void *p, size_t) noexcept                  { free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept     { free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept   { free(p); }
+
+void alloc_check_begin() {
+    alloc_check_count = 0;
+    alloc_check_task = xTaskGetCurrentTaskHandle();
+}
+
+void alloc_check_end() {
+    alloc_check_task = nullptr;
+    if (alloc_check_count != 0) loge(LOG_TAG, "The control tick made %lu heap allocations", (unsigned long) alloc_check_count);
+    assert(alloc_check_count == 0);
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+ * debug check that the control loop never allocates from the heap
+ *
+ * allocating can block on the heap lock, takes an unpredictable amount of time, and fragments the
+ * heap over a long match, so every control tick should run without touching it.  when ALLOC_CHECK
+ * is defined, every allocation made through operator new is counted, and the scheduler asserts
+ * that the control task didn't make any during a tick.
+*/
+
+#include <cstdint>
+#include "config.h"
+
+#ifdef ALLOC_CHECK
+
+    /**
+     * @brief Start counting the heap allocations made by the calling task
+     */
+    void alloc_check_begin();
+
+    /**
+     * @brief Stop counting heap allocations, and assert that there weren't any since alloc_check_begin()
+     */
+    void alloc_check_end();
+
+#else
+
+    // when the allocation check is disabled, these compile to nothing
+    inline void alloc_check_begin() {}
+    inline void alloc_check_end() {}
+
+#endif
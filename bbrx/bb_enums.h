@@ -63,6 +63,12 @@ inline std::vector<std::string> split(std::string& s, std::string& delimiter) {
  * - int bb_action_to_enum(std::string value);
  * - std::string bb_event_to_string(int value);
  * - int bb_event_to_enum(std::string value);
+ * - std::string bb_trigger_to_string(int value);
+ * - int bb_trigger_to_enum(std::string value);
+ * - std::string bb_filter_to_string(int value);
+ * - int bb_filter_to_enum(std::string value);
+ * - std::string bb_protocol_to_string(int value);
+ * - int bb_protocol_to_enum(std::string value);
 */
 
 
@@ -78,7 +84,10 @@ ENUM_MACRO(bb_action,
     BB_ACTION_SPEED_DOWN,
     BB_ACTION_SPEED_SET,
     BB_ACTION_BRAKE,
-    BB_ACTION_GPIO
+    BB_ACTION_GPIO,
+    BB_ACTION_RUMBLE,
+    BB_ACTION_LIGHTBAR,
+    BB_ACTION_PLAYER_LEDS
 );
 
 /**
@@ -139,4 +148,47 @@ ENUM_MACRO(bb_event,
 
     // misc
     BB_EVENT_MISC_BATTERY
-);
\ No newline at end of file
+);
+
+// number of members in bb_event (please keep this up to date if adding events!)
+#define BB_EVENT_COUNT (BB_EVENT_MISC_BATTERY + 1)
+
+
+/**
+ * @brief Enum containing supported binding trigger modes
+ * 
+ * RISING and FALLING are single bits, and BOTH is both of them, so the event manager can check
+ * which edges a binding responds to with a bitwise and.  please keep it that way!
+ */
+ENUM_MACRO(bb_trigger,
+    BB_TRIGGER_LEVEL,           // the action is run with the event's value every loop
+    BB_TRIGGER_RISING,          // the action is run once when the event is pressed
+    BB_TRIGGER_FALLING,         // the action is run once when the event is released
+    BB_TRIGGER_BOTH             // the action is run once when the event is pressed, and once when it's released
+);
+
+/**
+ * @brief Enum containing supported input filters
+ * 
+ */
+ENUM_MACRO(bb_filter,
+    BB_FILTER_EMA,              // exponential moving average
+    BB_FILTER_MEDIAN,           // median of the last 3 or 5 values
+    BB_FILTER_LOWPASS           // 2nd order (biquad) low-pass filter
+);
+
+/**
+ * @brief Enum containing supported servo output protocols
+ * 
+ */
+ENUM_MACRO(bb_protocol,
+    BB_PROTOCOL_PWM_50,         // 1000-2000µs pulses at 50 Hz (standard servo pwm)
+    BB_PROTOCOL_PWM_200,        // 1000-2000µs pulses at 200 Hz
+    BB_PROTOCOL_PWM_400,        // 1000-2000µs pulses at 400 Hz
+    BB_PROTOCOL_PWM_490,        // 1000-2000µs pulses at 490 Hz
+    BB_PROTOCOL_ONESHOT125,     // 125-250µs pulses (an eighth of the pwm pulse width)
+    BB_PROTOCOL_ONESHOT42,      // 42-84µs pulses (a 24th of the pwm pulse width)
+    BB_PROTOCOL_DSHOT150,       // digital throttle frames at 150 kbit/s
+    BB_PROTOCOL_DSHOT300,       // digital throttle frames at 300 kbit/s
+    BB_PROTOCOL_DSHOT600        // digital throttle frames at 600 kbit/s
+);
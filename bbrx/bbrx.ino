@@ -5,13 +5,18 @@
 #include "status_led.h"
 #include "log.h"
 #include "config.h"
+#include "scheduler.h"
+#include "latency.h"
+#include "filters.h"
+#include "feedback.h"
 
 #define LOG_TAG "main"
 
 void setup() {
 
     // setup serial
-    Serial.begin(115200);
+    LOG_OUTPUT.setTxBufferSize(LOG_TX_BUFFER_SIZE);
+    LOG_OUTPUT.begin(115200);
     delay(1500);
     logi(LOG_TAG, "\n=== bbrx! ===");
     logi(LOG_TAG, "version:     %s", VERSION_STRING);
@@ -37,22 +42,47 @@ void setup() {
     event_manager_setup();
 
     // finally, initialise each registered binding
-    for (auto b : bindings) {
+    for (auto &b : bindings) {
         initialise_binding(b);
     }
 
+    // and compile them into the plan that the event manager runs each loop
+    compile_bindings();
+
     // done!  now set the status led to idle
     leds_set_state(LED_IDLE);
 
+    // start running the event manager at a fixed rate.  from here on, controller input is
+    // parsed and bound actions are performed by the control task, not by loop()
+    scheduler_setup();
+
     logi(LOG_TAG, "Setup complete!");
 }
 
 void loop() {
 
-    // parse controller input and perform bound actions
-    event_manager_update();
-
-    // let the status led update
+    // let the status led update, and send any controller feedback the control loop asked for
     leds_update();
+    feedback_update();
+
+    // log stats (if enabled)
+    event_manager_log_stats();
+    scheduler_log_stats();
+    controller_log_stats();
+    filters_log_stats();
+    feedback_log_stats();
+
+    // serial commands
+    #ifdef LATENCY_STATS
+        while (LOG_OUTPUT.available()) {
+            switch (LOG_OUTPUT.read()) {
+                case 'l': latency_log();   break;
+                case 'r': latency_reset(); break;
+            }
+        }
+    #endif
+
+    // give the cpu back to the control task and bluetooth
+    delay(1);
 
 }
@@ -9,6 +9,7 @@
 #include "fkYAML/node.hpp"
 
 #include "event_manager.h"
+#include "controllers.h"
 #include "bb_enums.h"
 #include "log.h"
 #include "config.h"
@@ -38,6 +39,12 @@ int32_t BEEFZONE_BRAKE      = 1000;    // outer deadzone for the analog brake (L
 int32_t DEADZONE_THROTTLE   = 64;      // inner deadzone for the analog throttle (R2)
 int32_t BEEFZONE_THROTTLE   = 1000;    // outer deadzone for the analog throttle (R2)
 
+bool     EVENT_CHANGE_DRIVEN  = false;  // if true, only run bindings when the events they depend on change
+uint32_t EVENT_REFRESH_PERIOD = 20;     // when change-driven, how often to run every binding anyway (ms, 0 = never)
+
+uint16_t CONTROL_RATE         = 1000;   // how many times a second to run the event manager (Hz)
+bool     CONTROL_SLEEP_WHEN_IDLE = true;    // if true, the control loop stops ticking while there's nothing for it to do
+
 /**
  * @brief A vector containing all currently registered bindings.
  * 
@@ -65,6 +72,37 @@ std::vector<bb_binding> bindings = {
     {.action = BB_ACTION_SPEED_DOWN, .event = BB_EVENT_DPAD_DOWN, .min = 0, .max = 1},
 };
 
+/**
+ * @brief A vector containing the settings of each output channel that has any.
+ * 
+ * Output channels which aren't in this vector use the default settings (no slew limits).  This
+ * is applied to the output channels by event_manager:compile_bindings().
+ */
+std::vector<bb_output> outputs;
+
+/**
+ * @brief Vectors containing the inputs and outputs of the mixer (both empty if there isn't a mixer).
+ * 
+ * These are compiled by mixer:mixer_compile(), from event_manager:compile_bindings().
+ */
+std::vector<bb_mixer_input> mixer_inputs;
+std::vector<bb_mixer_output> mixer_outputs;
+
+/**
+ * @brief Vector containing the input filter stages, in the order they're applied.
+ * 
+ * These are compiled by filters:filters_compile(), from event_manager:compile_bindings().
+ */
+std::vector<bb_filter_config> filters;
+
+/**
+ * @brief A vector containing the settings of each controller slot that has any.
+ * 
+ * Slots which aren't in this vector use the default settings (the failsafe is enabled, with no timeout).  This
+ * is applied by event_manager:compile_bindings().
+ */
+std::vector<bb_controller_config> controller_configs;
+
 /**
  * Returns true if the specified node has a key with the name key, that is of the specified type
  */
@@ -194,6 +232,365 @@ bool parse_config(std::string yaml) {
 
         } else logd(LOG_TAG, "failed to load beefzones");
 
+        // get event manager object
+        if (check_key(root, "event_manager", fkyaml::node::node_t::MAPPING)) {
+
+            logd(LOG_TAG, "loading event manager settings...");
+            auto &event_manager = root["event_manager"];
+
+            if (check_key(event_manager, "change_driven", fkyaml::node::node_t::BOOLEAN)) {
+                EVENT_CHANGE_DRIVEN = event_manager["change_driven"].get_value<bool>();
+                logd(LOG_TAG, "- change_driven = %d", EVENT_CHANGE_DRIVEN);
+            } else logd(LOG_TAG, "- couldn't get change_driven");
+
+            if (check_key(event_manager, "refresh_period", fkyaml::node::node_t::INTEGER)) {
+                EVENT_REFRESH_PERIOD = event_manager["refresh_period"].get_value<uint32_t>();
+                logd(LOG_TAG, "- refresh_period = %d", EVENT_REFRESH_PERIOD);
+            } else logd(LOG_TAG, "- couldn't get refresh_period");
+
+            // newline
+            logd(LOG_TAG, "");
+
+        } else logd(LOG_TAG, "failed to load event manager settings");
+
+        // get scheduler object
+        if (check_key(root, "scheduler", fkyaml::node::node_t::MAPPING)) {
+
+            logd(LOG_TAG, "loading scheduler settings...");
+            auto &scheduler = root["scheduler"];
+
+            if (check_key(scheduler, "rate", fkyaml::node::node_t::INTEGER)) {
+                CONTROL_RATE = scheduler["rate"].get_value<uint16_t>();
+                logd(LOG_TAG, "- rate = %d", CONTROL_RATE);
+
+                // limit the rate here (rather than when the scheduler starts) so that anything which
+                // depends on the rate, like cumulative bindings, sees the rate that will actually be used
+                if (CONTROL_RATE < CONTROL_RATE_MIN || CONTROL_RATE > CONTROL_RATE_MAX) {
+                    CONTROL_RATE = min(max(CONTROL_RATE, (uint16_t) CONTROL_RATE_MIN), (uint16_t) CONTROL_RATE_MAX);
+                    logw(LOG_TAG, "scheduler rate must be between %d and %d Hz, using %d Hz", CONTROL_RATE_MIN, CONTROL_RATE_MAX, CONTROL_RATE);
+                }
+            } else logd(LOG_TAG, "- couldn't get rate");
+
+            if (check_key(scheduler, "sleep_when_idle", fkyaml::node::node_t::BOOLEAN)) {
+                CONTROL_SLEEP_WHEN_IDLE = scheduler["sleep_when_idle"].get_value<bool>();
+                logd(LOG_TAG, "- sleep_when_idle = %d", CONTROL_SLEEP_WHEN_IDLE);
+            } else logd(LOG_TAG, "- couldn't get sleep_when_idle");
+
+            // newline
+            logd(LOG_TAG, "");
+
+        } else logd(LOG_TAG, "failed to load scheduler settings");
+
+        // get outputs object
+        if (check_key(root, "outputs", fkyaml::node::node_t::SEQUENCE)) {
+
+            // first, clear existing output settings
+            outputs.clear();
+
+            // for each output
+            for (int i = 0; i < root["outputs"].size(); i++) {
+                auto &output = root["outputs"][i];
+
+                logd(LOG_TAG, "parsing output %d", i);
+
+                // create an output struct to populate
+                bb_output out;
+
+                if (check_key(output, "pin", fkyaml::node::node_t::INTEGER)) {
+                    out.pin = output["pin"].get_value<int>();
+                    logd(LOG_TAG, "- pin = %d", out.pin);
+                } else {
+                    logw(LOG_TAG, "missing pin key in output %d", i);
+                    continue;
+                }
+
+                if (check_key(output, "accelerate", fkyaml::node::node_t::INTEGER)) {
+                    out.accelerate = max(output["accelerate"].get_value<int32_t>(), (int32_t) 0);
+                    logd(LOG_TAG, "- accelerate = %d", out.accelerate);
+                } else {
+                    logd(LOG_TAG, "- couldn't get accelerate");
+                    out.accelerate = 0;
+                }
+
+                if (check_key(output, "decelerate", fkyaml::node::node_t::INTEGER)) {
+                    out.decelerate = max(output["decelerate"].get_value<int32_t>(), (int32_t) 0);
+                    logd(LOG_TAG, "- decelerate = %d", out.decelerate);
+                } else {
+                    logd(LOG_TAG, "- couldn't get decelerate");
+                    out.decelerate = 0;
+                }
+
+                if (check_key(output, "brake_bypass", fkyaml::node::node_t::BOOLEAN)) {
+                    out.brake_bypass = output["brake_bypass"].get_value<bool>();
+                    logd(LOG_TAG, "- brake_bypass = %d", out.brake_bypass);
+                } else {
+                    logd(LOG_TAG, "- couldn't get brake_bypass");
+                    out.brake_bypass = true;
+                }
+
+                if (check_key(output, "protocol", fkyaml::node::node_t::STRING)) {
+                    std::string protocol_str = output["protocol"].get_value<std::string>();
+                    int protocol_int = bb_protocol_to_enum(protocol_str);
+                    logd(LOG_TAG, "- protocol = %s (%d)", protocol_str.c_str(), protocol_int);
+                    if (protocol_int == -1) {
+                        logw(LOG_TAG, "invalid protocol key in output %d", i);
+                        out.protocol = ESC_DEFAULT_PROTOCOL;
+                    }
+                    else out.protocol = (bb_protocol) protocol_int;
+                } else {
+                    logd(LOG_TAG, "- couldn't get protocol");
+                    out.protocol = ESC_DEFAULT_PROTOCOL;
+                }
+
+                outputs.push_back(out);
+            }
+
+            // newline
+            logd(LOG_TAG, "");
+
+        } else logd(LOG_TAG, "failed to load output settings");
+
+        // get mixer object
+        if (check_key(root, "mixer", fkyaml::node::node_t::MAPPING)) {
+
+            logd(LOG_TAG, "loading mixer settings...");
+            auto &mixer = root["mixer"];
+
+            // first, clear the existing mixer
+            mixer_inputs.clear();
+            mixer_outputs.clear();
+
+            // mixer inputs
+            if (check_key(mixer, "inputs", fkyaml::node::node_t::SEQUENCE)) {
+                for (int i = 0; i < mixer["inputs"].size(); i++) {
+                    auto &input = mixer["inputs"][i];
+
+                    logd(LOG_TAG, "parsing mixer input %d", i);
+
+                    // unknown events are still added (so the weights of later inputs still line up)
+                    bb_mixer_input in = {.event = (bb_event) BB_EVENT_COUNT, .controller = 0, .min = -512, .max = 511};
+
+                    if (check_key(input, "event", fkyaml::node::node_t::STRING)) {
+                        std::string event_str = input["event"].get_value<std::string>();
+                        int event_int = bb_event_to_enum(event_str);
+                        logd(LOG_TAG, "- event = %s (%d)", event_str.c_str(), event_int);
+                        if (event_int == -1) logw(LOG_TAG, "invalid event key in mixer input %d", i);
+                        else in.event = (bb_event) event_int;
+                    } else logw(LOG_TAG, "missing event key in mixer input %d", i);
+
+                    if (check_key(input, "controller", fkyaml::node::node_t::INTEGER)) {
+                        in.controller = input["controller"].get_value<int>();
+                        logd(LOG_TAG, "- controller = %d", in.controller);
+                        if (in.controller >= BP32_MAX_GAMEPADS) {
+                            logw(LOG_TAG, "invalid controller key in mixer input %d", i);
+                            in.controller = 0;
+                        }
+                    } else logd(LOG_TAG, "- couldn't get controller");
+
+                    if (check_key(input, "min", fkyaml::node::node_t::INTEGER)) {
+                        in.min = input["min"].get_value<int32_t>();
+                        logd(LOG_TAG, "- min = %d", in.min);
+                    } else logd(LOG_TAG, "- couldn't get min");
+
+                    if (check_key(input, "max", fkyaml::node::node_t::INTEGER)) {
+                        in.max = input["max"].get_value<int32_t>();
+                        logd(LOG_TAG, "- max = %d", in.max);
+                    } else logd(LOG_TAG, "- couldn't get max");
+
+                    mixer_inputs.push_back(in);
+                }
+            } else logd(LOG_TAG, "- couldn't get inputs");
+
+            // mixer outputs
+            if (check_key(mixer, "outputs", fkyaml::node::node_t::SEQUENCE)) {
+                for (int i = 0; i < mixer["outputs"].size(); i++) {
+                    auto &output = mixer["outputs"][i];
+
+                    logd(LOG_TAG, "parsing mixer output %d", i);
+
+                    bb_mixer_output out = {.pin = 0, .clamp = 1, .expo = 0, .reverse = false};
+
+                    if (check_key(output, "pin", fkyaml::node::node_t::INTEGER)) {
+                        out.pin = output["pin"].get_value<int>();
+                        logd(LOG_TAG, "- pin = %d", out.pin);
+                    } else {
+                        logw(LOG_TAG, "missing pin key in mixer output %d", i);
+                        continue;
+                    }
+
+                    if (check_key(output, "weights", fkyaml::node::node_t::SEQUENCE)) {
+                        for (int j = 0; j < output["weights"].size(); j++) {
+                            auto &weight = output["weights"][j];
+                            float w = 0;
+                            if      (weight.type() == fkyaml::node::node_t::FLOAT_NUMBER) w = weight.get_value<float>();
+                            else if (weight.type() == fkyaml::node::node_t::INTEGER)      w = weight.get_value<int>();
+                            else logw(LOG_TAG, "invalid weight (number %d) in mixer output %d", j, i);
+                            logd(LOG_TAG, "- weight %d = %f", j, w);
+                            out.weights.push_back(w);
+                        }
+                    } else logw(LOG_TAG, "missing weights key in mixer output %d", i);
+
+                    if (check_key(output, "clamp", fkyaml::node::node_t::FLOAT_NUMBER)) {
+                        out.clamp = output["clamp"].get_value<float>();
+                        logd(LOG_TAG, "- clamp = %f", out.clamp);
+                    } else if (check_key(output, "clamp", fkyaml::node::node_t::INTEGER)) {
+                        out.clamp = output["clamp"].get_value<int>();
+                        logd(LOG_TAG, "- clamp = %f", out.clamp);
+                    } else logd(LOG_TAG, "- couldn't get clamp");
+
+                    if (check_key(output, "expo", fkyaml::node::node_t::FLOAT_NUMBER)) {
+                        out.expo = output["expo"].get_value<float>();
+                        logd(LOG_TAG, "- expo = %f", out.expo);
+                    } else if (check_key(output, "expo", fkyaml::node::node_t::INTEGER)) {
+                        out.expo = output["expo"].get_value<int>();
+                        logd(LOG_TAG, "- expo = %f", out.expo);
+                    } else logd(LOG_TAG, "- couldn't get expo");
+
+                    if (check_key(output, "reverse", fkyaml::node::node_t::BOOLEAN)) {
+                        out.reverse = output["reverse"].get_value<bool>();
+                        logd(LOG_TAG, "- reverse = %d", out.reverse);
+                    } else logd(LOG_TAG, "- couldn't get reverse");
+
+                    mixer_outputs.push_back(out);
+                }
+            } else logd(LOG_TAG, "- couldn't get outputs");
+
+            // newline
+            logd(LOG_TAG, "");
+
+        } else logd(LOG_TAG, "failed to load mixer settings");
+
+        // get filters object
+        if (check_key(root, "filters", fkyaml::node::node_t::SEQUENCE)) {
+
+            logd(LOG_TAG, "loading filters...");
+            filters.clear();
+
+            for (int i = 0; i < root["filters"].size(); i++) {
+                auto &filter = root["filters"][i];
+
+                logd(LOG_TAG, "parsing filter %d", i);
+
+                bb_filter_config stage = {.event = BB_EVENT_ANALOG_LX, .controller = 0, .type = BB_FILTER_EMA, .alpha = 0.5, .taps = 3, .cutoff = 20, .q = 0.707};
+
+                if (check_key(filter, "event", fkyaml::node::node_t::STRING)) {
+                    std::string event_str = filter["event"].get_value<std::string>();
+                    int event_int = bb_event_to_enum(event_str);
+                    logd(LOG_TAG, "- event = %s (%d)", event_str.c_str(), event_int);
+                    if (event_int == -1) {
+                        logw(LOG_TAG, "invalid event key in filter %d", i);
+                        continue;
+                    }
+                    stage.event = (bb_event) event_int;
+                } else {
+                    logw(LOG_TAG, "missing event key in filter %d", i);
+                    continue;
+                }
+
+                if (check_key(filter, "controller", fkyaml::node::node_t::INTEGER)) {
+                    stage.controller = filter["controller"].get_value<int>();
+                    logd(LOG_TAG, "- controller = %d", stage.controller);
+                    if (stage.controller >= BP32_MAX_GAMEPADS) {
+                        logw(LOG_TAG, "invalid controller key in filter %d", i);
+                        continue;
+                    }
+                } else logd(LOG_TAG, "- couldn't get controller");
+
+                if (check_key(filter, "type", fkyaml::node::node_t::STRING)) {
+                    std::string type_str = filter["type"].get_value<std::string>();
+                    int type_int = bb_filter_to_enum(type_str);
+                    logd(LOG_TAG, "- type = %s (%d)", type_str.c_str(), type_int);
+                    if (type_int == -1) {
+                        logw(LOG_TAG, "invalid type key in filter %d", i);
+                        continue;
+                    }
+                    stage.type = (bb_filter) type_int;
+                } else {
+                    logw(LOG_TAG, "missing type key in filter %d", i);
+                    continue;
+                }
+
+                if (check_key(filter, "alpha", fkyaml::node::node_t::FLOAT_NUMBER)) {
+                    stage.alpha = filter["alpha"].get_value<float>();
+                    logd(LOG_TAG, "- alpha = %f", stage.alpha);
+                } else if (check_key(filter, "alpha", fkyaml::node::node_t::INTEGER)) {
+                    stage.alpha = filter["alpha"].get_value<int>();
+                    logd(LOG_TAG, "- alpha = %f", stage.alpha);
+                } else logd(LOG_TAG, "- couldn't get alpha");
+
+                if (check_key(filter, "taps", fkyaml::node::node_t::INTEGER)) {
+                    stage.taps = filter["taps"].get_value<int>();
+                    logd(LOG_TAG, "- taps = %d", stage.taps);
+                } else logd(LOG_TAG, "- couldn't get taps");
+
+                if (check_key(filter, "cutoff", fkyaml::node::node_t::FLOAT_NUMBER)) {
+                    stage.cutoff = filter["cutoff"].get_value<float>();
+                    logd(LOG_TAG, "- cutoff = %f", stage.cutoff);
+                } else if (check_key(filter, "cutoff", fkyaml::node::node_t::INTEGER)) {
+                    stage.cutoff = filter["cutoff"].get_value<int>();
+                    logd(LOG_TAG, "- cutoff = %f", stage.cutoff);
+                } else logd(LOG_TAG, "- couldn't get cutoff");
+
+                if (check_key(filter, "q", fkyaml::node::node_t::FLOAT_NUMBER)) {
+                    stage.q = filter["q"].get_value<float>();
+                    logd(LOG_TAG, "- q = %f", stage.q);
+                } else if (check_key(filter, "q", fkyaml::node::node_t::INTEGER)) {
+                    stage.q = filter["q"].get_value<int>();
+                    logd(LOG_TAG, "- q = %f", stage.q);
+                } else logd(LOG_TAG, "- couldn't get q");
+
+                filters.push_back(stage);
+            }
+
+            // newline
+            logd(LOG_TAG, "");
+
+        } else logd(LOG_TAG, "failed to load filters");
+
+        // get controllers object
+        if (check_key(root, "controllers", fkyaml::node::node_t::SEQUENCE)) {
+
+            logd(LOG_TAG, "loading controller slot settings...");
+            controller_configs.clear();
+
+            for (int i = 0; i < root["controllers"].size(); i++) {
+                auto &controller = root["controllers"][i];
+
+                logd(LOG_TAG, "parsing controller slot %d", i);
+
+                bb_controller_config config = {.slot = 0, .failsafe = true, .timeout = 0};
+
+                if (check_key(controller, "slot", fkyaml::node::node_t::INTEGER)) {
+                    config.slot = controller["slot"].get_value<int>();
+                    logd(LOG_TAG, "- slot = %d", config.slot);
+                    if (config.slot >= BP32_MAX_GAMEPADS) {
+                        logw(LOG_TAG, "invalid slot key in controller %d (there are %d slots)", i, BP32_MAX_GAMEPADS);
+                        continue;
+                    }
+                } else {
+                    logw(LOG_TAG, "missing slot key in controller %d", i);
+                    continue;
+                }
+
+                if (check_key(controller, "failsafe", fkyaml::node::node_t::BOOLEAN)) {
+                    config.failsafe = controller["failsafe"].get_value<bool>();
+                    logd(LOG_TAG, "- failsafe = %d", config.failsafe);
+                } else logd(LOG_TAG, "- couldn't get failsafe");
+
+                if (check_key(controller, "timeout", fkyaml::node::node_t::INTEGER)) {
+                    int timeout = controller["timeout"].get_value<int>();
+                    config.timeout = min(max(timeout, 0), 0xFFFF);
+                    logd(LOG_TAG, "- timeout = %d", config.timeout);
+                } else logd(LOG_TAG, "- couldn't get timeout");
+
+                controller_configs.push_back(config);
+            }
+
+            // newline
+            logd(LOG_TAG, "");
+
+        } else logd(LOG_TAG, "failed to load controller slot settings");
+
         // get bindings object
         if (check_key(root, "bindings", fkyaml::node::node_t::SEQUENCE)) {
 
@@ -348,6 +745,44 @@ bool parse_config(std::string yaml) {
                 }
 
 
+                //------------------------
+                // check for colour key
+                //------------------------
+
+                if (check_key(bind, "colour", fkyaml::node::node_t::INTEGER)) {
+
+                    // get colour as an int (0xRRGGBB)
+                    int colour = bind["colour"].get_value<int>();
+                    logd(LOG_TAG, "- colour int 0x%06x", colour);
+                    bin.colour = colour & 0xFFFFFF;
+
+                } else {
+                    logd(LOG_TAG, "- missing or invalid colour key");
+                    bin.colour = 0xFFFFFF;
+                }
+
+
+                //------------------------
+                // check for controller key
+                //------------------------
+
+                if (check_key(bind, "controller", fkyaml::node::node_t::INTEGER)) {
+
+                    // get controller as an int
+                    int controller = bind["controller"].get_value<int>();
+                    logd(LOG_TAG, "- controller int %d", controller);
+                    if (controller < 0 || controller >= BP32_MAX_GAMEPADS) {
+                        logw(LOG_TAG, "invalid controller key in binding %d (there are %d controller slots)", i, BP32_MAX_GAMEPADS);
+                        has_required = false;
+                    }
+                    else bin.controller = controller;
+
+                } else {
+                    logd(LOG_TAG, "- missing or invalid controller key");
+                    bin.controller = 0;
+                }
+
+
                 //------------------------
                 // check for exec_without_controller key
                 //------------------------
@@ -503,6 +938,237 @@ bool parse_config(std::string yaml) {
                 }
 
 
+                //------------------------
+                // check for accumulate key
+                //------------------------
+
+                if (check_key(bind, "accumulate", fkyaml::node::node_t::BOOLEAN)) {
+
+                    // get accumulate as an bool
+                    bool accumulate = bind["accumulate"].get_value<bool>();
+                    logd(LOG_TAG, "- accumulate bool %d", accumulate);
+                    bin.accumulate = accumulate;
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid accumulate key in binding %d", i);
+                    bin.accumulate = false;
+                }
+
+
+                //------------------------
+                // check for accumulate_gain key
+                //------------------------
+
+                if (check_key(bind, "accumulate_gain", fkyaml::node::node_t::FLOAT_NUMBER)) {
+
+                    // get accumulate_gain as a float
+                    bin.accumulate_gain = bind["accumulate_gain"].get_value<float>();
+                    logd(LOG_TAG, "- accumulate_gain float %f", bin.accumulate_gain);
+
+                } else if (check_key(bind, "accumulate_gain", fkyaml::node::node_t::INTEGER)) {
+
+                    // get accumulate_gain as an int
+                    bin.accumulate_gain = bind["accumulate_gain"].get_value<int>();
+                    logd(LOG_TAG, "- accumulate_gain int %d", (int) bin.accumulate_gain);
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid accumulate_gain key in binding %d", i);
+                    bin.accumulate_gain = 1;
+                }
+
+
+                //------------------------
+                // check for accumulate_decay key
+                //------------------------
+
+                if (check_key(bind, "accumulate_decay", fkyaml::node::node_t::FLOAT_NUMBER)) {
+
+                    // get accumulate_decay as a float
+                    bin.accumulate_decay = bind["accumulate_decay"].get_value<float>();
+                    logd(LOG_TAG, "- accumulate_decay float %f", bin.accumulate_decay);
+
+                } else if (check_key(bind, "accumulate_decay", fkyaml::node::node_t::INTEGER)) {
+
+                    // get accumulate_decay as an int
+                    bin.accumulate_decay = bind["accumulate_decay"].get_value<int>();
+                    logd(LOG_TAG, "- accumulate_decay int %d", (int) bin.accumulate_decay);
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid accumulate_decay key in binding %d", i);
+                    bin.accumulate_decay = 0;
+                }
+
+
+                //------------------------
+                // check for accumulate_min key
+                //------------------------
+
+                if (check_key(bind, "accumulate_min", fkyaml::node::node_t::INTEGER)) {
+
+                    // get accumulate_min as an int
+                    int accumulate_min = bind["accumulate_min"].get_value<int>();
+                    logd(LOG_TAG, "- accumulate_min int %d", accumulate_min);
+                    bin.accumulate_min = accumulate_min;
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid accumulate_min key in binding %d", i);
+                    bin.accumulate_min = min(bin.min, bin.max);
+                }
+
+
+                //------------------------
+                // check for accumulate_max key
+                //------------------------
+
+                if (check_key(bind, "accumulate_max", fkyaml::node::node_t::INTEGER)) {
+
+                    // get accumulate_max as an int
+                    int accumulate_max = bind["accumulate_max"].get_value<int>();
+                    logd(LOG_TAG, "- accumulate_max int %d", accumulate_max);
+                    bin.accumulate_max = accumulate_max;
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid accumulate_max key in binding %d", i);
+                    bin.accumulate_max = max(bin.min, bin.max);
+                }
+
+
+                //------------------------
+                // check for trigger key
+                //------------------------
+
+                bin.trigger = BB_TRIGGER_LEVEL;
+                if (check_key(bind, "trigger", fkyaml::node::node_t::STRING)) {
+
+                    // get trigger as a string
+                    std::string trigger_str = bind["trigger"].get_value<std::string>();
+                    logd(LOG_TAG, "- trigger string %s", trigger_str.c_str());
+
+                    // try to get enum id (int) from string
+                    int trigger_int = bb_trigger_to_enum(trigger_str);
+                    logd(LOG_TAG, "- trigger int %d", trigger_int);
+
+                    // try to determine enum from int
+                    if (trigger_int == -1) {
+                        logw(LOG_TAG, "invalid trigger key in binding %d, using BB_TRIGGER_LEVEL", i);
+                    } else {
+                        bin.trigger = (bb_trigger) trigger_int;
+                    }
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid trigger key in binding %d", i);
+                }
+
+
+                //------------------------
+                // check for debounce key
+                //------------------------
+
+                if (check_key(bind, "debounce", fkyaml::node::node_t::INTEGER)) {
+
+                    // get debounce as an int
+                    int debounce = bind["debounce"].get_value<int>();
+                    logd(LOG_TAG, "- debounce int %d", debounce);
+                    bin.debounce = min(max(debounce, 0), 0xFFFF);
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid debounce key in binding %d", i);
+                    bin.debounce = 0;
+                }
+
+
+                //------------------------
+                // check for repeat_rate key
+                //------------------------
+
+                if (check_key(bind, "repeat_rate", fkyaml::node::node_t::FLOAT_NUMBER)) {
+
+                    // get repeat_rate as a float
+                    bin.repeat_rate = bind["repeat_rate"].get_value<float>();
+                    logd(LOG_TAG, "- repeat_rate float %f", bin.repeat_rate);
+
+                } else if (check_key(bind, "repeat_rate", fkyaml::node::node_t::INTEGER)) {
+
+                    // get repeat_rate as an int
+                    bin.repeat_rate = bind["repeat_rate"].get_value<int>();
+                    logd(LOG_TAG, "- repeat_rate int %d", (int) bin.repeat_rate);
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid repeat_rate key in binding %d", i);
+                    bin.repeat_rate = 0;
+                }
+
+
+                //------------------------
+                // check for repeat_delay key
+                //------------------------
+
+                if (check_key(bind, "repeat_delay", fkyaml::node::node_t::INTEGER)) {
+
+                    // get repeat_delay as an int
+                    int repeat_delay = bind["repeat_delay"].get_value<int>();
+                    logd(LOG_TAG, "- repeat_delay int %d", repeat_delay);
+                    bin.repeat_delay = min(max(repeat_delay, 0), 0xFFFF);
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid repeat_delay key in binding %d", i);
+                    bin.repeat_delay = REPEAT_DEFAULT_DELAY;
+                }
+
+
+                //------------------------
+                // check for expo key
+                //------------------------
+
+                if (check_key(bind, "expo", fkyaml::node::node_t::FLOAT_NUMBER)) {
+
+                    // get expo as a float
+                    bin.expo = bind["expo"].get_value<float>();
+                    logd(LOG_TAG, "- expo float %f", bin.expo);
+
+                } else if (check_key(bind, "expo", fkyaml::node::node_t::INTEGER)) {
+
+                    // get expo as an int
+                    bin.expo = bind["expo"].get_value<int>();
+                    logd(LOG_TAG, "- expo int %d", (int) bin.expo);
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid expo key in binding %d", i);
+                    bin.expo = 0;
+                }
+
+
+                //------------------------
+                // check for curve key
+                //------------------------
+
+                if (check_key(bind, "curve", fkyaml::node::node_t::SEQUENCE)) {
+
+                    // each control point is a list of [x, y]
+                    for (int j = 0; j < bind["curve"].size(); j++) {
+                        auto &point = bind["curve"][j];
+                        float xy[2];
+                        bool valid = (point.type() == fkyaml::node::node_t::SEQUENCE) && (point.size() == 2);
+
+                        for (int k = 0; valid && k < 2; k++) {
+                            auto &value = point[k];
+                            if      (value.type() == fkyaml::node::node_t::FLOAT_NUMBER) xy[k] = value.get_value<float>();
+                            else if (value.type() == fkyaml::node::node_t::INTEGER)      xy[k] = value.get_value<int>();
+                            else valid = false;
+                        }
+
+                        if (valid) {
+                            logd(LOG_TAG, "- curve point %d = (%f, %f)", j, xy[0], xy[1]);
+                            bin.curve.push_back({.x = xy[0], .y = xy[1]});
+                        }
+                        else logw(LOG_TAG, "invalid curve point (number %d) in binding %d", j, i);
+                    }
+
+                } else {
+                    logd(LOG_TAG, "missing or invalid curve key in binding %d", i);
+                }
+
+
                 //------------------------
                 // after all params have been parsed, add to bindings (if all required params are passed)
                 //------------------------
@@ -28,7 +28,8 @@
 #define ESC_PWM_MIN             1000    // minimum pulse width in µs
 #define ESC_PWM_MID             1500    // half-way pulse width in µs
 #define ESC_PWM_MAX             2000    // maximum pulse width in µs
-#define ESC_PWM_FREQ            50      // pwm frequency in Hz
+#define ESC_DEFAULT_PROTOCOL    BB_PROTOCOL_PWM_50  // protocol of servo outputs which don't have one set in config.yml
+#define ESC_MAX_CHANNELS        16      // maximum number of pins that can output servo pwm (limited by the number of LEDC channels)
 
 //-------------------------------------------
 // config.yml loading settings
@@ -53,6 +54,85 @@
 bool load_config();
 
 
+//-------------------------------------------
+// event manager
+//-------------------------------------------
+
+// #define EVENT_LOOP_STATS                     // when defined, the event manager will periodically log how many loops it's running per second
+#define EVENT_LOOP_STATS_PERIOD     5000        // how often to log the loop rate (ms)
+#define EVENT_MAX_CLAIM_SLOTS       64          // maximum number of distinct combinations of action and pin that bindings can use
+#define REPEAT_WHEEL_SLOTS          256         // number of slots in the timer wheel used for repeating bindings (power of two; more slots = fewer timers to skip over each tick)
+#define REPEAT_DEFAULT_DELAY        500         // default time a repeating binding's event has to be held before it starts repeating (ms)
+#define MIXER_MAX_INPUTS            8           // maximum number of mixer inputs
+#define MIXER_MAX_OUTPUTS           16          // maximum number of mixer outputs
+#define MIXER_MAX_WEIGHT            4           // largest magnitude of a mixer weight
+#define CURVE_MAX_TABLES            16          // maximum number of distinct response curves that bindings can use
+
+extern bool     EVENT_CHANGE_DRIVEN;        // if true, only run bindings when the events they depend on change
+extern uint32_t EVENT_REFRESH_PERIOD;       // when change-driven, how often to run every binding anyway (ms, 0 = never)
+
+
+//-------------------------------------------
+// input filters
+//-------------------------------------------
+
+#define FILTER_MAX_STAGES           32          // maximum number of filter stages across every event
+#define FILTER_SETTLE_TICKS         16          // number of ticks a filter's output has to stay the same for before the filter counts as settled
+// #define FILTER_STATS                         // when defined, how long each filter stage takes to run will be logged periodically
+#define FILTER_STATS_PERIOD         5000        // how often to log the filter stats (ms)
+
+
+//-------------------------------------------
+// control loop scheduler
+//-------------------------------------------
+
+#define CONTROL_RATE_MIN            250         // minimum control loop rate (Hz)
+#define CONTROL_RATE_MAX            2000        // maximum control loop rate (Hz)
+#define CONTROL_TASK_STACK          8192        // stack size of the control task (bytes)
+#define CONTROL_TASK_PRIORITY       10          // priority of the control task (higher than the arduino loop task)
+#define CONTROL_TASK_CORE           ARDUINO_RUNNING_CORE    // which core to run the control task on
+
+// #define SCHEDULER_STATS                      // when defined, the jitter and overrun stats of the control loop will be logged periodically
+#define SCHEDULER_STATS_PERIOD      5000        // how often to log the scheduler stats (ms)
+// #define ALLOC_CHECK                          // when defined, heap allocations are counted, and each control tick asserts that it didn't make any (see alloc_check.h)
+
+extern uint16_t CONTROL_RATE;               // how many times a second to run the event manager (Hz)
+extern bool     CONTROL_SLEEP_WHEN_IDLE;    // if true, the control loop stops ticking while there's nothing for it to do
+
+
+//-------------------------------------------
+// input task
+//-------------------------------------------
+
+#define INPUT_TASK_STACK            8192        // stack size of the input task, which polls bluepad32 (bytes)
+#define INPUT_TASK_PRIORITY         5           // priority of the input task
+#define INPUT_TASK_CORE             0           // which core to run the input task on (should be different to CONTROL_TASK_CORE)
+#define INPUT_TASK_POLL_TICKS       1           // how long the input task waits between polls of bluepad32 (FreeRTOS ticks)
+
+// #define CONTROLLER_STATS                     // when defined, the number of published, dropped and stale input snapshots will be logged periodically
+#define CONTROLLER_STATS_PERIOD     5000        // how often to log the input snapshot stats (ms)
+
+
+//-------------------------------------------
+// controller feedback
+//-------------------------------------------
+
+#define FEEDBACK_PERIOD             50          // shortest time between two rounds of feedback being sent to the controllers (ms)
+#define FEEDBACK_RUMBLE_DURATION    500         // how long each rumble command lasts; rumble which is still going is resent before it runs out (ms)
+#define FEEDBACK_DEFAULT_COLOUR     0x00CED1    // lightbar colour when nothing has asked for a different one (0xRRGGBB)
+// #define FEEDBACK_STATS                       // when defined, the number of feedback changes requested and commands sent will be logged periodically
+#define FEEDBACK_STATS_PERIOD       5000        // how often to log the feedback stats (ms)
+
+
+//-------------------------------------------
+// latency measurement
+//-------------------------------------------
+
+// #define LATENCY_STATS                        // when defined, the time from each controller report to the resulting change in each servo pulse is measured.  send 'l' over serial to log it, or 'r' to reset it
+#define LATENCY_BUCKET_WIDTH        50          // width of each latency histogram bucket (µs)
+#define LATENCY_BUCKETS             64          // number of latency histogram buckets (the last one also counts everything longer)
+
+
 //-------------------------------------------
 // failsafes
 //-------------------------------------------
@@ -61,6 +141,7 @@ bool load_config();
 // or you can disable specific failsafes by uncommenting their specific define
 #define ENABLE_FAILSAFES                // when defined, failsafes will be enabled.  PLEASE DON'T DISABLE THIS UNLESS YOU REALLY REALLY REALLY NEED TO!!!!!!!PLEASE
 #define FAILSAFE_NO_CONTROLLER          // enables the failsafe where if no controllers are detected, the motors will be killed
+#define FAILSAFE_STALE_INPUT            // enables the failsafe where a controller which stops sending reports (for longer than its slot's timeout) is treated as disconnected
 
 
 //-------------------------------------------
@@ -70,6 +151,19 @@ bool load_config();
 // vector storing all bindings
 extern std::vector<bb_binding> bindings;
 
+// vector storing the settings of each output channel which has any
+extern std::vector<bb_output> outputs;
+
+// vectors storing the inputs and outputs of the mixer
+extern std::vector<bb_mixer_input> mixer_inputs;
+extern std::vector<bb_mixer_output> mixer_outputs;
+
+// vector storing the input filter stages, in the order they're applied
+extern std::vector<bb_filter_config> filters;
+
+// vector storing the settings of each controller slot which has any
+extern std::vector<bb_controller_config> controller_configs;
+
 // Deadzones and Beefzones
 // each binding specifies a minimum and maximum value for the input range
 // deadzone is the value below which the input defaults to 0
@@ -101,4 +195,16 @@ extern int32_t BEEFZONE_THROTTLE;   // outer deadzone for the analog throttle (R
 // #define STATUS_LED_POWER_PIN        8        // please make sure this doesn't conflict with anything else because it will be pulled high for the duration of the program
 #define STATUS_NUM_LEDS             1
 #define STATUS_LED_TYPE             NEOPIXEL
-#define STATUS_LED_INIT_BRIGHTNESS  35
\ No newline at end of file
+#define STATUS_LED_INIT_BRIGHTNESS  35
+#define STATUS_LED_QUEUE_LENGTH     8       // how many state changes can be requested between status led updates
+
+// FastLED sends to the status LED with the RMT peripheral, which DShot outputs use too.  so that they
+// can share it, FastLED is built to use esp-idf's RMT driver (rather than its own interrupt handler)
+// and only its first channel, and DShot outputs start after the channels FastLED has
+#define FASTLED_RMT_BUILTIN_DRIVER  1
+#define FASTLED_RMT_MAX_CHANNELS    1       // number of RMT channels FastLED uses, starting from channel 0
+#ifdef STATUS_LED_ENABLE
+    #define ESC_DSHOT_FIRST_RMT_CHANNEL FASTLED_RMT_MAX_CHANNELS    // first RMT channel DShot outputs can use
+#else
+    #define ESC_DSHOT_FIRST_RMT_CHANNEL 0
+#endif
\ No newline at end of file
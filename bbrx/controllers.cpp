@@ -1,26 +1,135 @@
 #include <Arduino.h>
 #include <Bluepad32.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "controllers.h"
+#include "triple_buffer.h"
 #include "status_led.h"
+#include "scheduler.h"
+#include "feedback.h"
 #include "log.h"
 #include "config.h"
 
 #define LOG_TAG "controller"
 
-ControllerPtr controller;
+ControllerPtr controllers[BP32_MAX_GAMEPADS];   // controller in each slot (nullptr if the slot is free)
+
+TaskHandle_t input_task = nullptr;              // task which polls bluepad32 and captures snapshots
+bb_input_frame input_frame;                     // (input task) latest snapshot of every slot, which is copied into the triple buffer to publish it
+triple_buffer<bb_input_frame> snapshots;        // hands snapshots from the input task (producer) to the control task (consumer)
+bb_input_stats input_stats;                     // snapshot hand-over counters (published/dropped are only written by the input task, consumed/stale by the control task)
+bb_input_stats input_stats_logged;              // values of the counters when they were last logged
+unsigned long input_stats_last_log = 0;         // time at which the counters were last logged (ms)
+bb_link_stats link_stats[BP32_MAX_GAMEPADS];    // (input task) report counters of each slot
+uint32_t link_reports_logged[BP32_MAX_GAMEPADS];    // number of reports in each slot when the link stats were last logged
+volatile bool link_stats_reset = false;         // set to ask the input task to reset the max gaps
+
+/**
+ * @brief Apply a deadzone and beefzone to a controller input
+ * 
+ * @param input the current value of the input
+ * @param dead the minimum input value to not be considered 0 (both + and -)
+ * @param beef the maximum input value to not be considered max (both + and -)
+ * @return int32_t the input, 0 if it's in the deadzone, or BB_INPUT_BEEF_MAX / BB_INPUT_BEEF_MIN if it's past the beefzone
+ */
+int32_t deadzone(int32_t input, int32_t dead, int32_t beef) {
+    if (input > -dead && input < dead) return 0;
+    if (input > beef)                  return BB_INPUT_BEEF_MAX;
+    if (input < -beef)                 return BB_INPUT_BEEF_MIN;
+    return input;
+}
+
+/**
+ * @brief Read the value of every event from a controller into a snapshot
+ * 
+ * @param ctl the controller to read
+ * @param snapshot the snapshot to fill in
+ */
+void controller_capture(ControllerPtr ctl, bb_input_snapshot &snapshot) {
+
+    int32_t *v = snapshot.values;
+    uint8_t dpad = ctl->dpad();
+
+    snapshot.time = micros();
+    snapshot.connected = true;
+
+    v[BB_EVENT_ANALOG_LX]            = deadzone(ctl->axisX(),    DEADZONE_LX,       BEEFZONE_LX);
+    v[BB_EVENT_ANALOG_LY]            = deadzone(ctl->axisY(),    DEADZONE_LY,       BEEFZONE_LY);
+    v[BB_EVENT_ANALOG_RX]            = deadzone(ctl->axisRX(),   DEADZONE_RX,       BEEFZONE_RX);
+    v[BB_EVENT_ANALOG_RY]            = deadzone(ctl->axisRY(),   DEADZONE_RY,       BEEFZONE_RY);
+    v[BB_EVENT_ANALOG_BRAKE]         = deadzone(ctl->brake(),    DEADZONE_BRAKE,    BEEFZONE_BRAKE);
+    v[BB_EVENT_ANALOG_THROTTLE]      = deadzone(ctl->throttle(), DEADZONE_THROTTLE, BEEFZONE_THROTTLE);
+    v[BB_EVENT_GYRO_X]               = ctl->gyroX();
+    v[BB_EVENT_GYRO_Y]               = ctl->gyroY();
+    v[BB_EVENT_GYRO_Z]               = ctl->gyroZ();
+    v[BB_EVENT_ACCEL_X]              = ctl->accelX();
+    v[BB_EVENT_ACCEL_Y]              = ctl->accelY();
+    v[BB_EVENT_ACCEL_Z]              = ctl->accelZ();
+    v[BB_EVENT_DPAD_UP]              = dpad & 0x01;
+    v[BB_EVENT_DPAD_DOWN]            = dpad & 0x02;
+    v[BB_EVENT_DPAD_LEFT]            = dpad & 0x08;
+    v[BB_EVENT_DPAD_RIGHT]           = dpad & 0x04;
+    v[BB_EVENT_BTN_A]                = ctl->a();
+    v[BB_EVENT_BTN_B]                = ctl->b();
+    v[BB_EVENT_BTN_X]                = ctl->x();
+    v[BB_EVENT_BTN_Y]                = ctl->y();
+    v[BB_EVENT_BTN_L1]               = ctl->l1();
+    v[BB_EVENT_BTN_L2]               = ctl->l2();
+    v[BB_EVENT_BTN_R1]               = ctl->r1();
+    v[BB_EVENT_BTN_R2]               = ctl->r2();
+    v[BB_EVENT_BTN_L3]               = ctl->thumbL();
+    v[BB_EVENT_BTN_R3]               = ctl->thumbR();
+    v[BB_EVENT_BTN_SYSTEM]           = ctl->miscSystem();
+    v[BB_EVENT_BTN_START]            = ctl->miscStart();
+    v[BB_EVENT_BTN_SELECT]           = ctl->miscSelect();
+    v[BB_EVENT_BTN_CAPTURE]          = ctl->miscCapture();
+    v[BB_EVENT_MOUSE_DX]             = ctl->deltaX();
+    v[BB_EVENT_MOUSE_DY]             = ctl->deltaY();
+    v[BB_EVENT_MOUSE_SCROLLWHEEL]    = ctl->scrollWheel();
+    v[BB_EVENT_WII_BB_TOP_LEFT]      = ctl->topLeft();
+    v[BB_EVENT_WII_BB_TOP_RIGHT]     = ctl->topRight();
+    v[BB_EVENT_WII_BB_BOTTOM_LEFT]   = ctl->bottomLeft();
+    v[BB_EVENT_WII_BB_BOTTOM_RIGHT]  = ctl->bottomRight();
+    v[BB_EVENT_WII_BB_TEMPERATURE]   = ctl->temperature();
+    v[BB_EVENT_MISC_BATTERY]         = ctl->battery();
+
+    // collect the digital events into a bitmask, so conditionals can test them all at once
+    uint64_t pressed = 0;
+    for (uint8_t evt = BB_EVENT_DIGITAL_FIRST; evt <= BB_EVENT_DIGITAL_LAST; evt++) {
+        if (v[evt]) pressed |= 1ULL << evt;
+    }
+    snapshot.pressed = pressed;
+}
+
+int32_t controller_pressed_value(uint8_t evt) {
+    switch (evt) {
+        case BB_EVENT_DPAD_UP:      return 0x01;
+        case BB_EVENT_DPAD_DOWN:    return 0x02;
+        case BB_EVENT_DPAD_LEFT:    return 0x08;
+        case BB_EVENT_DPAD_RIGHT:   return 0x04;
+        default:                    return 1;
+    }
+}
 
 /**
 Callback for when a new controller is connected
 */
 void controller_callback_connected(ControllerPtr ctl) {
 
-    // if no other controller is connected
-    if (controller == nullptr) {
+    // find the first free slot
+    int slot = -1;
+    for (int i = 0; i < BP32_MAX_GAMEPADS && slot == -1; i++) {
+        if (controllers[i] == nullptr) slot = i;
+    }
+
+    // if there's a free slot
+    if (slot != -1) {
 
         // store pointer to controller
-        controller = ctl;
+        controllers[slot] = ctl;
 
         // print controller info
-        logi(LOG_TAG, "Connected to a controller!");
+        logi(LOG_TAG, "Connected to a controller in slot %d!", slot);
         logi(LOG_TAG, "  - model:   %s", ctl->getModelName().c_str());
         logi(LOG_TAG, "  - battery: %d%%", (ctl->battery() / 255) * 100);
 
@@ -33,15 +142,16 @@ void controller_callback_connected(ControllerPtr ctl) {
             properties.vendor_id, properties.product_id, properties.flags
         );
 
-        // set LED colour
-        ctl->setColorLED(0x00, 0xCE, 0xD1);
+        // set LED colour, and show the slot on the player LEDs (these are sent by the main loop, so
+        // bluetooth output never holds up the input task)
+        feedback_reset(slot);
 
         // set status led
-        leds_set_state(LED_CONNECTED);
+        leds_request_state(LED_CONNECTED);
 
     }
     else {
-        logw(LOG_TAG, "Attempted to connect to new controller, but couldn't because already connected to a different one");
+        logw(LOG_TAG, "Attempted to connect to new controller, but couldn't because all %d slots are in use", BP32_MAX_GAMEPADS);
 
         // disconnect the new gamepad so it knows it's not actually doing anything
         ctl->disconnect();
@@ -54,14 +164,77 @@ Callback for when a controller is disconnected
 */
 void controller_callback_disconnected(ControllerPtr ctl) {
 
-    if (ctl == controller) {
-        logi(LOG_TAG, "Controller disconnected!");
-        controller = nullptr;
+    for (int slot = 0; slot < BP32_MAX_GAMEPADS; slot++) {
+        if (ctl != controllers[slot]) continue;
+
+        logi(LOG_TAG, "Controller in slot %d disconnected!", slot);
+        controllers[slot] = nullptr;
 
         // set status led
-        leds_set_state(LED_IDLE);
-    } else {
-        logw(LOG_TAG, "Mysterious unknown gamepad disconnected");
+        if (!controller_connected()) leds_request_state(LED_IDLE);
+        return;
+    }
+
+    logw(LOG_TAG, "Mysterious unknown gamepad disconnected");
+
+}
+
+/**
+ * @brief Task which polls Bluepad32 and publishes input snapshots for the control task
+ * 
+ * This runs on a different core to the control task, so that Bluetooth work never holds up
+ * the control loop.
+ */
+void input_task_main(void *arg) {
+
+    for (;;) {
+
+        // update bluepad32.  this also runs the connect and disconnect callbacks
+        bool fresh = BP32.update();
+        bool publish = false;
+
+        if (link_stats_reset) {
+            for (bb_link_stats &link : link_stats) link.max_gap = 0;
+            link_stats_reset = false;
+        }
+
+        // capture a new snapshot for each slot with new input, or whose controller has (dis)connected
+        uint8_t connected = 0;
+        for (uint8_t slot = 0; slot < BP32_MAX_GAMEPADS; slot++) {
+            ControllerPtr ctl = controllers[slot];
+            bb_input_snapshot &snapshot = input_frame.slots[slot];
+
+            if (ctl != nullptr) {
+                connected |= 1 << slot;
+                if ((fresh && ctl->hasData()) || !snapshot.connected) {
+                    bool was_connected = snapshot.connected;
+                    uint32_t last = snapshot.time;
+                    controller_capture(ctl, snapshot);
+                    publish = true;
+
+                    // time the gaps between reports (the first report from a controller doesn't have one)
+                    bb_link_stats &link = link_stats[slot];
+                    link.reports++;
+                    if (was_connected && snapshot.time - last > link.max_gap) link.max_gap = snapshot.time - last;
+                }
+            }
+            else if (snapshot.connected) {
+                snapshot.time = micros();
+                snapshot.connected = false;
+                publish = true;
+            }
+        }
+        input_frame.connected = connected;
+
+        // publish every slot together, so the control task sees them all at once
+        if (publish) {
+            snapshots.back() = input_frame;
+            if (snapshots.publish()) input_stats.dropped++;
+            input_stats.published++;
+            scheduler_wake();
+        }
+
+        vTaskDelay(INPUT_TASK_POLL_TICKS);
     }
 
 }
@@ -70,26 +243,73 @@ void controller_setup() {
     logi(LOG_TAG, "Setting up Bluepad32");
     logi(LOG_TAG, "BP32 version: %s", BP32.firmwareVersion());
     BP32.setup(&controller_callback_connected, &controller_callback_disconnected);
+
+    // start polling for input
+    xTaskCreatePinnedToCore(input_task_main, "bbrx input", INPUT_TASK_STACK, nullptr, INPUT_TASK_PRIORITY, &input_task, INPUT_TASK_CORE);
+    input_stats_last_log = millis();
+
     logi(LOG_TAG, "Listening for controllers...");
 }
 
-void controller_handle(std::function<void(ControllerPtr controller)> callback) {
+const bb_input_frame &controller_read() {
 
-    // update bluepad32
-    BP32.update();
+    // get the latest snapshots from the input task (or keep using the previous ones)
+    if (snapshots.update()) input_stats.consumed++;
+    else                    input_stats.stale++;
 
-    // call callback
-    // note: callback must check if controller is nullptr!!!
-    callback(controller);
+    return snapshots.front();
 
 }
 
-bool controller_connected() {
+bool controller_pending() {
+    return snapshots.fresh();
+}
+
+void controller_log_stats() {
 
-    // this should return true if >=1 controller is connected.  bbrx only supports
-    // one controller at a time for now, so really this function returns true if
-    // The Controller is connected
+    #ifdef CONTROLLER_STATS
 
-    return (controller != nullptr);
+        unsigned long elapsed = millis() - input_stats_last_log;
+        if (elapsed < CONTROLLER_STATS_PERIOD) return;
+        input_stats_last_log = millis();
+
+        // the counters are never reset (they're written by other tasks), so log how much they've changed by
+        bb_input_stats stats = input_stats;
+        logi(LOG_TAG, "snapshots: %lu published, %lu dropped | %lu consumed, %lu stale",
+            (unsigned long) (stats.published - input_stats_logged.published),
+            (unsigned long) (stats.dropped   - input_stats_logged.dropped),
+            (unsigned long) (stats.consumed  - input_stats_logged.consumed),
+            (unsigned long) (stats.stale     - input_stats_logged.stale)
+        );
+        input_stats_logged = stats;
+
+        // report rate and longest gap of each slot with a controller, which the slot's timeout
+        // should be comfortably longer than
+        for (uint8_t slot = 0; slot < BP32_MAX_GAMEPADS; slot++) {
+            uint32_t reports = link_stats[slot].reports;
+            uint32_t count = reports - link_reports_logged[slot];
+            link_reports_logged[slot] = reports;
+            if (controllers[slot] == nullptr) continue;
+            logi(LOG_TAG, "slot %d link: %lu reports/s, max gap %lu ms", slot,
+                (unsigned long) (count * 1000UL / elapsed),
+                (unsigned long) (link_stats[slot].max_gap / 1000)
+            );
+        }
+        link_stats_reset = true;
+
+    #endif
+
+}
+
+ControllerPtr controller_get(uint8_t slot) {
+    return (slot < BP32_MAX_GAMEPADS) ? controllers[slot] : nullptr;
+}
+
+bool controller_connected() {
+
+    for (ControllerPtr ctl : controllers) {
+        if (ctl != nullptr) return true;
+    }
+    return false;
 
 }
\ No newline at end of file
@@ -1,21 +1,114 @@
 #pragma once
 
 #include <Bluepad32.h>
-#include <functional>
+#include <climits>
+#include "bb_enums.h"
+
+// values stored in an input snapshot for analog inputs which are past their beefzone.
+// these get resolved to the max or min of each binding's range by the event manager
+#define BB_INPUT_BEEF_MAX   INT32_MAX       // input is above the beefzone
+#define BB_INPUT_BEEF_MIN   INT32_MIN       // input is below the negative beefzone
+
+/**
+ * @brief The value of every gamepad event at a single point in time, for one controller
+ * 
+ * A snapshot is captured once each time controller input is handled, so that every binding
+ * sees the same view of the inputs, and so that each input is only read (and deadzoned) once.
+ */
+struct bb_input_snapshot {
+    int32_t  values[BB_EVENT_COUNT];        // value of each event, indexed by bb_event.  deadzones are already applied, and beefzones are marked using BB_INPUT_BEEF_MAX / BB_INPUT_BEEF_MIN
+    uint64_t pressed;                       // bitmask of the digital events (see BB_EVENT_DIGITAL_FIRST) which are pressed, indexed by bb_event
+    uint32_t time;                          // time at which the report was received and the snapshot was captured (µs)
+    bool     connected;                     // whether a controller was connected (if not, values is meaningless)
+};
 
 /**
-Sets up Bluepad32.  Should only be called once.
+ * @brief The latest snapshot of every controller slot
+ * 
+ * Each controller is given a slot when it connects (the lowest one which is free), and keeps
+ * it until it disconnects.  Bindings read their events from the snapshot of one slot.
+ */
+struct bb_input_frame {
+    bb_input_snapshot slots[BP32_MAX_GAMEPADS];     // snapshot of each slot (connected is false if there's no controller in the slot)
+    uint8_t  connected;                     // bitmask of the slots which have a controller
+};
+static_assert(BP32_MAX_GAMEPADS <= 8, "controller slots are tracked in 8 bit masks");
+
+// the digital events (the d-pad and buttons) are the contiguous range of events from BB_EVENT_DIGITAL_FIRST to BB_EVENT_DIGITAL_LAST
+#define BB_EVENT_DIGITAL_FIRST  BB_EVENT_DPAD_UP
+#define BB_EVENT_DIGITAL_LAST   BB_EVENT_BTN_CAPTURE
+#define BB_EVENT_IS_DIGITAL(evt) ((evt) >= BB_EVENT_DIGITAL_FIRST && (evt) <= BB_EVENT_DIGITAL_LAST)
+
+/**
+ * @brief Counters for the hand-over of input snapshots from the input task to the control task
+ */
+struct bb_input_stats {
+    uint32_t published;                     // number of snapshots published by the input task
+    uint32_t dropped;                       // number of snapshots which were replaced by a newer one before the control task read them
+    uint32_t consumed;                      // number of new snapshots read by the control task
+    uint32_t stale;                         // number of times the control task found no new snapshot, and reused the previous one
+};
+
+/**
+ * @brief Counters for the reports received from the controller in a slot, for tuning the stale input failsafe
+ */
+struct bb_link_stats {
+    uint32_t reports;                       // number of reports received in the slot
+    uint32_t max_gap;                       // longest time between two reports from the same controller since the stats were last logged (µs)
+};
+
+/**
+Sets up Bluepad32, and starts the input task which polls it.  Should only be called once.
 */
 void controller_setup();
 
 /**
-Read the current controller input, and pass it to a callback
+Get the latest snapshot of every controller slot from the input task.  This never waits for
+Bluetooth, and should only be called by the control task.  The frame stays the same until the
+next call (the caller must check whether each slot is connected!!!).
 */
-void controller_handle(std::function<void(ControllerPtr controller)> callback);
+const bb_input_frame &controller_read();
+
+/**
+Check whether the input task has published a snapshot which controller_read() hasn't picked up
+yet.  Should only be called by the control task.
+*/
+bool controller_pending();
+
+/**
+Log the snapshot hand-over counters and each slot's link stats, if it's time to.  Should be called
+from the main loop.
+*/
+void controller_log_stats();
+
+/**
+ * @brief Get the value that a digital event has in a snapshot when it's pressed
+ * 
+ * Digital events are 0 when not pressed.  When pressed, buttons are 1, and the d-pad directions
+ * are their bit in the d-pad bitmask.
+ * 
+ * @param evt the digital event
+ * @return int32_t the event's value when pressed
+ */
+int32_t controller_pressed_value(uint8_t evt);
+
+/**
+ * @brief Get the controller in a slot
+ * 
+ * Like controller_connected(), this reflects the input task's view, so it's meant for sending
+ * things to the controller rather than for reading input.
+ * 
+ * @param slot the controller slot
+ * @return ControllerPtr the controller, or nullptr if the slot is free
+ */
+ControllerPtr controller_get(uint8_t slot);
 
 /**
  * @brief Indicates whether at least one controller is connected
  * 
+ * Note that this reflects the input task's view.  The control task should check whether its
+ * snapshot is nullptr instead, so it's consistent with the input it's acting on.
+ * 
  * @return true one or more controllers are connected
  * @return false no controllers are connected
  */
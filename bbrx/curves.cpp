@@ -0,0 +1,80 @@
+#include <Arduino.h>
+#include <cmath>
+#include <cstring>
+#include "curves.h"
+#include "log.h"
+
+#define LOG_TAG "curves"
+
+int16_t curve_arena[CURVE_MAX_TABLES][CURVE_POINTS];    // every curve table in use
+uint8_t curve_count = 0;                                // number of tables in the arena
+
+void curves_clear() {
+    curve_count = 0;
+}
+
+/**
+ * @brief Work out the output of a curve for an input
+ *
+ * @param x the input, from -1 to 1
+ * @param expo see curve_make()
+ * @param points control points, sorted by x (if empty, expo is used)
+ * @return double the output, from -1 to 1
+ */
+static double curve_evaluate(double x, double expo, const std::vector<bb_curve_point> &points) {
+
+    if (points.empty()) return (1 - expo) * x + expo * x * x * x;
+
+    // flat beyond the first and last points, and straight lines between them
+    if (x <= points.front().x) return points.front().y;
+    if (x >= points.back().x)  return points.back().y;
+    for (size_t i = 1; i < points.size(); i++) {
+        const bb_curve_point &a = points[i - 1];
+        const bb_curve_point &b = points[i];
+        if (x <= b.x) return (b.x > a.x) ? a.y + (b.y - a.y) * (x - a.x) / (b.x - a.x) : b.y;
+    }
+    return points.back().y;
+}
+
+const int16_t *curve_make(float expo, const std::vector<bb_curve_point> &points) {
+
+    // limit the expo and points to the curve's range, and put the points in order
+    if (std::isnan(expo)) expo = 0;
+    expo = std::min(std::max(expo, 0.0f), 1.0f);
+
+    std::vector<bb_curve_point> sorted;
+    for (bb_curve_point p : points) {
+        if (std::isnan(p.x) || std::isnan(p.y)) continue;
+        p.x = std::min(std::max(p.x, -1.0f), 1.0f);
+        p.y = std::min(std::max(p.y, -1.0f), 1.0f);
+        sorted.push_back(p);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const bb_curve_point &a, const bb_curve_point &b) { return a.x < b.x; });
+
+    if (sorted.empty() && expo == 0) return nullptr;
+
+    // bake the table
+    int16_t table[CURVE_POINTS];
+    bool linear = true;
+    for (int i = 0; i < CURVE_POINTS; i++) {
+        double x = (2.0 * i / CURVE_SEGMENTS) - 1;
+        double y = curve_evaluate(x, expo, sorted);
+        table[i] = lround(std::min(std::max(y, -1.0), 1.0) * CURVE_ONE);
+        if (table[i] != lround(x * CURVE_ONE)) linear = false;
+    }
+    if (linear) return nullptr;
+
+    // share the table with any identical curve
+    for (uint8_t t = 0; t < curve_count; t++) {
+        if (memcmp(curve_arena[t], table, sizeof(table)) == 0) return curve_arena[t];
+    }
+
+    if (curve_count >= CURVE_MAX_TABLES) {
+        logw(LOG_TAG, "Only %d different curves are supported; using a linear response instead", CURVE_MAX_TABLES);
+        return nullptr;
+    }
+
+    memcpy(curve_arena[curve_count], table, sizeof(table));
+    logi(LOG_TAG, "Made curve table %d (%d bytes)", curve_count, (int) sizeof(table));
+    return curve_arena[curve_count++];
+}
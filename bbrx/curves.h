@@ -0,0 +1,57 @@
+#pragma once
+
+/*
+ * response curves, which reshape the value of a binding's event before the action gets it
+ *
+ * a curve maps -1..+1 onto -1..+1, where 0 is the binding's default value and ±1 are the ends of
+ * its input range.  curves are worked out once when the bindings are compiled, and stored as a
+ * table of CURVE_POINTS evenly spaced outputs in a shared arena (bindings with identical curves
+ * share a table).  each tick, the curve is looked up in the table and linearly interpolated,
+ * all in fixed point, so there's no pow() or floating point in the control loop.
+*/
+
+#include <cstdint>
+#include <vector>
+#include "config.h"
+
+#define CURVE_SEGMENTS      256                     // number of straight lines the curve is approximated by (power of two)
+#define CURVE_POINTS        (CURVE_SEGMENTS + 1)    // number of entries in each curve table
+#define CURVE_FRAC_BITS     8                       // fractional bits of the position between two table entries
+#define CURVE_SHIFT         14
+#define CURVE_ONE           (1 << CURVE_SHIFT)      // fixed-point value of 1 in a curve table
+
+/**
+ * @brief Forget every curve table
+ *
+ * Should be called before the bindings are compiled, since every pointer returned by curve_make()
+ * is invalidated.
+ */
+void curves_clear();
+
+/**
+ * @brief Bake a curve into a table in the curve arena
+ *
+ * @param expo how much to soften the curve around 0, from 0 (linear) to 1 (cubic)
+ * @param points control points of a custom curve (used instead of expo if not empty)
+ * @return const int16_t* the table (CURVE_POINTS entries, from -CURVE_ONE to CURVE_ONE), or nullptr if
+ * the curve is linear or the arena is full
+ */
+const int16_t *curve_make(float expo, const std::vector<bb_curve_point> &points);
+
+/**
+ * @brief Look up a curve
+ *
+ * @param table the curve's table, from curve_make()
+ * @param position where to look up, from 0 (-1) to CURVE_SEGMENTS << CURVE_FRAC_BITS (+1)
+ * @return int32_t the output of the curve at that position, from -CURVE_ONE to CURVE_ONE
+ */
+inline int32_t curve_apply(const int16_t *table, int32_t position) {
+    if (position <= 0) return table[0];
+    if (position >= (CURVE_SEGMENTS << CURVE_FRAC_BITS)) return table[CURVE_SEGMENTS];
+
+    int32_t index = position >> CURVE_FRAC_BITS;
+    int32_t frac  = position & ((1 << CURVE_FRAC_BITS) - 1);
+    int32_t lo = table[index];
+    int32_t hi = table[index + 1];
+    return lo + (((hi - lo) * frac) >> CURVE_FRAC_BITS);
+}
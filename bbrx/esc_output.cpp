@@ -0,0 +1,407 @@
+#include <Arduino.h>
+#include <driver/ledc.h>
+#include <driver/rmt.h>
+#include "esc_output.h"
+#include "log.h"
+
+#define LOG_TAG "esc"
+
+#define ESC_LEDC_CLOCK      80000000        // frequency of the clock the LEDC timers count (APB clock, Hz)
+#define ESC_RMT_CLOCK       80000000        // frequency of the clock the RMT channels count (APB clock, Hz)
+#define ESC_RMT_CLOCK_DIV   1               // RMT clock divider (so each tick is 12.5ns)
+
+#define DSHOT_FRAME_BITS    16              // bits in a DShot frame
+#define DSHOT_MIN_THROTTLE  48              // lowest DShot throttle value (values below this are commands)
+#define DSHOT_MAX_THROTTLE  2047            // highest DShot throttle value
+
+/**
+ * @brief Pulse rate of each protocol, and how much the pulse width is divided by
+ *
+ * OneShot is normally sent once per loop, straight after the loop, but the LEDC peripheral can
+ * only send pulses at a fixed rate.  Sending them faster than the control loop runs gets close.
+ */
+struct bb_protocol_timing {
+    uint32_t  freq;                                 // pulse rate (Hz)
+    uint32_t  divisor;                              // pulse width = µs between ESC_PWM_MIN and ESC_PWM_MAX / divisor
+};
+
+static const bb_protocol_timing protocol_timings[] = {      // indexed by bb_protocol
+    {50,   1},                                      // BB_PROTOCOL_PWM_50
+    {200,  1},                                      // BB_PROTOCOL_PWM_200
+    {400,  1},                                      // BB_PROTOCOL_PWM_400
+    {490,  1},                                      // BB_PROTOCOL_PWM_490
+    {2000, 8},                                      // BB_PROTOCOL_ONESHOT125
+    {8000, 24},                                     // BB_PROTOCOL_ONESHOT42
+};
+
+static const uint32_t dshot_bitrates[] = {          // indexed by bb_protocol - BB_PROTOCOL_DSHOT150
+    150000,                                         // BB_PROTOCOL_DSHOT150
+    300000,                                         // BB_PROTOCOL_DSHOT300
+    600000,                                         // BB_PROTOCOL_DSHOT600
+};
+
+/**
+ * @brief Whether a protocol is DShot (sent with RMT), rather than analog pulses (sent with LEDC)
+ */
+static inline bool protocol_is_dshot(bb_protocol protocol) {
+    return protocol >= BB_PROTOCOL_DSHOT150;
+}
+
+/**
+ * @brief A LEDC timer, which can be shared by every channel using the same protocol
+ */
+struct bb_esc_timer {
+    uint32_t  freq;                                 // pulse rate (Hz)
+    uint8_t   bits;                                 // duty cycle resolution (bits)
+    uint8_t   users;                                // number of channels using the timer (0 = free)
+};
+
+/**
+ * @brief A RMT channel sending DShot frames, with two frame buffers
+ *
+ * Each new frame is encoded into the buffer which isn't being sent, and then the buffers are
+ * swapped, so a frame is never changed while the driver might still be reading it.
+ */
+struct bb_esc_rmt {
+    rmt_item32_t  items[2][DSHOT_FRAME_BITS];       // ping-pong frame buffers
+    uint8_t       front;                            // which buffer holds the frame being sent
+    uint16_t      bit_ticks;                        // length of each bit (RMT ticks)
+    uint16_t      one_ticks;                        // how long a 1 bit is high for (RMT ticks)
+    uint16_t      zero_ticks;                       // how long a 0 bit is high for (RMT ticks)
+    bool          used;                             // whether an output channel is using the RMT channel
+};
+
+/**
+ * @brief State of each output channel
+ */
+struct bb_esc_channel {
+    uint8_t        pin;                             // which pin the channel outputs on
+    bool           attached;                        // whether the channel has been set up
+    bool           digital;                         // whether the channel uses RMT (DShot) rather than LEDC
+    bb_protocol    protocol;                        // which protocol the channel uses
+    ledc_mode_t    mode;                            // LEDC speed mode of the channel
+    ledc_channel_t ledc;                            // LEDC channel within that speed mode
+    ledc_timer_t   timer;                           // LEDC timer the channel uses
+    rmt_channel_t  rmt;                             // RMT channel the channel uses (if digital)
+    uint32_t       multiplier;                      // duty cycle per µs of pulse width (fixed point, 16 fractional bits)
+    int32_t        us;                              // last pulse width written (µs, 0 = nothing written yet)
+    uint32_t       duty;                            // duty cycle (or DShot frame) to send on the next flush
+    uint32_t       sent;                            // duty cycle (or DShot frame) the peripheral has (0 = nothing sent yet, or UINT32_MAX for DShot)
+};
+
+bb_esc_timer esc_timers[LEDC_SPEED_MODE_MAX][LEDC_TIMER_MAX];   // every LEDC timer
+bool esc_ledc_used[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX];      // whether each LEDC channel is used by an output channel
+bb_esc_rmt esc_rmt[RMT_CHANNEL_MAX];                            // every RMT channel
+bb_esc_channel esc_channels[ESC_MAX_CHANNELS];                  // every output channel
+uint8_t esc_channel_count = 0;                                  // one more than the highest attached channel
+
+static_assert(sizeof(protocol_timings) / sizeof(protocol_timings[0]) == BB_PROTOCOL_ONESHOT42 + 1, "every analog protocol needs a timing");
+static_assert(sizeof(dshot_bitrates) / sizeof(dshot_bitrates[0]) == BB_PROTOCOL_DSHOT600 - BB_PROTOCOL_DSHOT150 + 1, "every DShot protocol needs a bitrate");
+static_assert(ESC_DSHOT_FIRST_RMT_CHANNEL < RMT_CHANNEL_MAX, "there has to be at least one RMT channel for DShot");
+
+/**
+ * @brief Find a timer in a speed mode which is running at a certain rate
+ *
+ * @return int the timer, or -1 if there isn't one
+ */
+static int esc_timer_find(ledc_mode_t mode, uint32_t freq) {
+    for (uint8_t t = 0; t < LEDC_TIMER_MAX; t++) {
+        if (esc_timers[mode][t].users && esc_timers[mode][t].freq == freq) return t;
+    }
+    return -1;
+}
+
+/**
+ * @brief Find a timer in a speed mode which isn't being used
+ *
+ * @return int the timer, or -1 if they're all being used
+ */
+static int esc_timer_free(ledc_mode_t mode) {
+    for (uint8_t t = 0; t < LEDC_TIMER_MAX; t++) {
+        if (!esc_timers[mode][t].users) return t;
+    }
+    return -1;
+}
+
+/**
+ * @brief Find a LEDC channel in a speed mode which an output channel can use
+ *
+ * @return int the LEDC channel (the output channel's current one, if it's in that speed mode), or -1 if there isn't one
+ */
+static int esc_ledc_free(ledc_mode_t mode, const bb_esc_channel &ch) {
+    if (ch.attached && !ch.digital && ch.mode == mode) return ch.ledc;
+    for (uint8_t c = 0; c < LEDC_CHANNEL_MAX; c++) {
+        if (!esc_ledc_used[mode][c]) return c;
+    }
+    return -1;
+}
+
+/**
+ * @brief Let go of the RMT channel an output channel is using (if it's using one)
+ */
+static void esc_rmt_release(bb_esc_channel &ch) {
+    if (!ch.attached || !ch.digital) return;
+    rmt_driver_uninstall(ch.rmt);
+    esc_rmt[ch.rmt].used = false;
+}
+
+/**
+ * @brief Let go of the LEDC timer and channel an output channel is using (if it's using them)
+ */
+static void esc_ledc_release(bb_esc_channel &ch) {
+    if (!ch.attached || ch.digital) return;
+    esc_timers[ch.mode][ch.timer].users--;
+    ledc_stop(ch.mode, ch.ledc, 0);
+    esc_ledc_used[ch.mode][ch.ledc] = false;
+}
+
+/**
+ * @brief Connect an output channel to a RMT channel for a DShot protocol, and work out its bit timings
+ */
+static bool esc_channel_configure_dshot(bb_esc_channel &ch, bb_protocol protocol) {
+
+    // keep the RMT channel if it already has one, otherwise find a free one
+    int r = -1;
+    if (ch.attached && ch.digital) r = ch.rmt;
+    else {
+        // (the channels before ESC_DSHOT_FIRST_RMT_CHANNEL belong to the status LED)
+        for (uint8_t i = ESC_DSHOT_FIRST_RMT_CHANNEL; i < RMT_CHANNEL_MAX && r == -1; i++) {
+            if (!esc_rmt[i].used) r = i;
+        }
+        if (r == -1) {
+            loge(LOG_TAG, "No RMT channels left for DShot on pin %d", ch.pin);
+            return false;
+        }
+
+        rmt_config_t config = {};
+        config.rmt_mode                 = RMT_MODE_TX;
+        config.channel                  = (rmt_channel_t) r;
+        config.gpio_num                 = (gpio_num_t) ch.pin;
+        config.clk_div                  = ESC_RMT_CLOCK_DIV;
+        config.mem_block_num            = 1;
+        config.tx_config.idle_level     = RMT_IDLE_LEVEL_LOW;
+        config.tx_config.idle_output_en = true;
+        if (rmt_config(&config) != ESP_OK || rmt_driver_install((rmt_channel_t) r, 0, 0) != ESP_OK) {
+            loge(LOG_TAG, "Couldn't set up RMT channel %d on pin %d", r, ch.pin);
+            return false;
+        }
+
+        esc_ledc_release(ch);
+        esc_rmt[r].used = true;
+    }
+
+    // a 1 bit is high for 3/4 of the bit, and a 0 bit for 3/8
+    bb_esc_rmt &rmt = esc_rmt[r];
+    uint32_t bitrate = dshot_bitrates[protocol - BB_PROTOCOL_DSHOT150];
+    rmt.bit_ticks  = (ESC_RMT_CLOCK / ESC_RMT_CLOCK_DIV + bitrate / 2) / bitrate;
+    rmt.one_ticks  = (rmt.bit_ticks * 3 + 2) / 4;
+    rmt.zero_ticks = (rmt.bit_ticks * 3 + 4) / 8;
+    logd(LOG_TAG, "RMT channel %d: %lu bit/s, %d ticks per bit", r, (unsigned long) bitrate, rmt.bit_ticks);
+
+    ch.protocol = protocol;
+    ch.rmt      = (rmt_channel_t) r;
+    ch.digital  = true;
+    ch.attached = true;
+
+    // the frame needs encoding again with the new timings (zero throttle is frame 0, so this uses a value that can't be a frame)
+    ch.sent = UINT32_MAX;
+    if (ch.us) esc_output_write(&ch - esc_channels, ch.us);
+    return true;
+}
+
+/**
+ * @brief Connect an output channel to a timer for a protocol, and work out its duty cycle multiplier
+ *
+ * Channels go in a speed mode which already has a timer at the protocol's rate if possible, and
+ * otherwise in one which has a free timer.
+ */
+static bool esc_channel_configure(bb_esc_channel &ch, bb_protocol protocol) {
+
+    if (protocol_is_dshot(protocol)) return esc_channel_configure_dshot(ch, protocol);
+
+    const bb_protocol_timing &timing = protocol_timings[protocol];
+    if ((uint32_t) ESC_PWM_MAX / timing.divisor >= 1000000 / timing.freq) {
+        logw(LOG_TAG, "Pulses of up to %dµs don't fit in %s's period", ESC_PWM_MAX / timing.divisor, bb_protocol_to_string(protocol).c_str());
+    }
+
+    // pick a speed mode, timer and LEDC channel
+    int mode = -1, timer = -1, ledc = -1;
+    for (int pass = 0; pass < 2 && mode == -1; pass++) {
+        for (int m = 0; m < LEDC_SPEED_MODE_MAX; m++) {
+            int t = pass ? esc_timer_free((ledc_mode_t) m) : esc_timer_find((ledc_mode_t) m, timing.freq);
+            int c = esc_ledc_free((ledc_mode_t) m, ch);
+            if (t == -1 || c == -1) continue;
+            mode = m;
+            timer = t;
+            ledc = c;
+            break;
+        }
+    }
+    if (mode == -1) {
+        loge(LOG_TAG, "No LEDC timers or channels left for %lu Hz pulses on pin %d", (unsigned long) timing.freq, ch.pin);
+        return false;
+    }
+
+    bb_esc_timer &t = esc_timers[mode][timer];
+    if (!t.users) {
+
+        // use as many bits as the clock allows
+        uint8_t resolution = LEDC_TIMER_BIT_MAX - 1;
+        while (resolution > 1 && ((uint64_t) timing.freq << resolution) > ESC_LEDC_CLOCK) resolution--;
+
+        ledc_timer_config_t config = {
+            .speed_mode      = (ledc_mode_t) mode,
+            .duty_resolution = (ledc_timer_bit_t) resolution,
+            .timer_num       = (ledc_timer_t) timer,
+            .freq_hz         = timing.freq,
+            .clk_cfg         = LEDC_AUTO_CLK,
+        };
+        if (ledc_timer_config(&config) != ESP_OK) {
+            loge(LOG_TAG, "Couldn't set up LEDC timer %d (speed mode %d) at %lu Hz", timer, mode, (unsigned long) timing.freq);
+            return false;
+        }
+        t.freq = timing.freq;
+        t.bits = resolution;
+        logd(LOG_TAG, "LEDC timer %d (speed mode %d): %lu Hz, %d bits", timer, mode, (unsigned long) timing.freq, resolution);
+    }
+
+    ledc_channel_config_t config = {
+        .gpio_num   = ch.pin,
+        .speed_mode = (ledc_mode_t) mode,
+        .channel    = (ledc_channel_t) ledc,
+        .intr_type  = LEDC_INTR_DISABLE,
+        .timer_sel  = (ledc_timer_t) timer,
+        .duty       = 0,
+        .hpoint     = 0,
+    };
+    if (ledc_channel_config(&config) != ESP_OK) {
+        loge(LOG_TAG, "Couldn't set up LEDC channel %d (speed mode %d) on pin %d", ledc, mode, ch.pin);
+        return false;
+    }
+
+    // let go of the old timer and LEDC channel (or RMT channel)
+    t.users++;
+    if (ch.attached && !ch.digital) {
+        esc_timers[ch.mode][ch.timer].users--;
+        if (ch.mode != mode || ch.ledc != ledc) {
+            ledc_stop(ch.mode, ch.ledc, 0);
+            esc_ledc_used[ch.mode][ch.ledc] = false;
+        }
+    }
+    esc_rmt_release(ch);
+    esc_ledc_used[mode][ledc] = true;
+
+    // duty per µs = 2^bits * freq / (divisor * 1000000)
+    ch.multiplier = (((uint64_t) timing.freq << (t.bits + 16)) + (timing.divisor * 1000000ULL) / 2) / (timing.divisor * 1000000ULL);
+    ch.protocol   = protocol;
+    ch.mode       = (ledc_mode_t) mode;
+    ch.ledc       = (ledc_channel_t) ledc;
+    ch.timer      = (ledc_timer_t) timer;
+    ch.digital    = false;
+    ch.attached   = true;
+
+    // the duty cycle was reset, so send the last pulse width again on the next flush
+    ch.sent = 0;
+    if (ch.us) esc_output_write(&ch - esc_channels, ch.us);
+    return true;
+}
+
+bool esc_output_attach(uint8_t channel, uint8_t pin, bb_protocol protocol) {
+
+    if (channel >= ESC_MAX_CHANNELS) {
+        loge(LOG_TAG, "Can't output on pin %d; there are only %d output channels", pin, ESC_MAX_CHANNELS);
+        return false;
+    }
+
+    bb_esc_channel &ch = esc_channels[channel];
+    ch = {.pin = pin, .attached = false, .digital = false, .us = 0, .duty = 0, .sent = 0};
+    if (!esc_channel_configure(ch, protocol)) return false;
+
+    if (channel >= esc_channel_count) esc_channel_count = channel + 1;
+    logd(LOG_TAG, "Output channel %d on pin %d using %s", channel, pin, bb_protocol_to_string(protocol).c_str());
+    return true;
+}
+
+bool esc_output_set_protocol(uint8_t channel, bb_protocol protocol) {
+    bb_esc_channel &ch = esc_channels[channel];
+    if (!ch.attached) return false;
+    if (ch.protocol == protocol) return true;
+    return esc_channel_configure(ch, protocol);
+}
+
+void esc_output_write(uint8_t channel, int32_t us) {
+    bb_esc_channel &ch = esc_channels[channel];
+    us = min(max(us, (int32_t) ESC_PWM_MIN), (int32_t) ESC_PWM_MAX);
+    ch.us   = us;
+    ch.duty = ch.digital ? dshot_frame(dshot_throttle(us), false) : ((uint64_t) us * ch.multiplier + (1 << 15)) >> 16;
+}
+
+int32_t esc_output_neutral(uint8_t channel) {
+    return esc_channels[channel].digital ? ESC_PWM_MIN : ESC_PWM_MID;
+}
+
+uint16_t dshot_frame(uint16_t value, bool telemetry) {
+    uint16_t data = (value << 1) | (telemetry ? 1 : 0);
+    uint16_t checksum = (data ^ (data >> 4) ^ (data >> 8)) & 0x0F;
+    return (data << 4) | checksum;
+}
+
+uint16_t dshot_throttle(int32_t us) {
+    if (us <= ESC_PWM_MIN) return 0;
+    if (us >= ESC_PWM_MAX) return DSHOT_MAX_THROTTLE;
+    const int32_t range = ESC_PWM_MAX - ESC_PWM_MIN;
+    return DSHOT_MIN_THROTTLE + ((us - ESC_PWM_MIN) * (DSHOT_MAX_THROTTLE - DSHOT_MIN_THROTTLE) + range / 2) / range;
+}
+
+/**
+ * @brief Encode a DShot frame into RMT items, one item per bit
+ */
+static void dshot_encode(uint16_t frame, rmt_item32_t *items, const bb_esc_rmt &rmt) {
+    for (uint8_t bit = 0; bit < DSHOT_FRAME_BITS; bit++) {
+        uint16_t high = (frame & (0x8000 >> bit)) ? rmt.one_ticks : rmt.zero_ticks;
+        items[bit].level0    = 1;
+        items[bit].duration0 = high;
+        items[bit].level1    = 0;
+        items[bit].duration1 = rmt.bit_ticks - high;
+    }
+}
+
+void esc_output_flush() {
+
+    // set every duty cycle first, then latch them all, so channels sharing a timer change on the same pulse
+    bool changed[ESC_MAX_CHANNELS];
+    for (uint8_t channel = 0; channel < esc_channel_count; channel++) {
+        bb_esc_channel &ch = esc_channels[channel];
+        changed[channel] = ch.attached && !ch.digital && ch.us && ch.duty != ch.sent;
+        if (changed[channel]) ledc_set_duty(ch.mode, ch.ledc, ch.duty);
+    }
+    for (uint8_t channel = 0; channel < esc_channel_count; channel++) {
+        bb_esc_channel &ch = esc_channels[channel];
+        if (!changed[channel]) continue;
+        ledc_update_duty(ch.mode, ch.ledc);
+        ch.sent = ch.duty;
+    }
+
+    // send a frame on every DShot channel.  new frames are encoded into the back buffer, so the
+    // peripheral can be clocking out one frame while the next is being encoded
+    for (uint8_t channel = 0; channel < esc_channel_count; channel++) {
+        bb_esc_channel &ch = esc_channels[channel];
+        if (!ch.attached || !ch.digital || !ch.us) continue;
+
+        bb_esc_rmt &rmt = esc_rmt[ch.rmt];
+        if (ch.duty != ch.sent) {
+            rmt.front ^= 1;
+            dshot_encode(ch.duty, rmt.items[rmt.front], rmt);
+            ch.sent = ch.duty;
+        }
+        rmt_write_items(ch.rmt, rmt.items[rmt.front], DSHOT_FRAME_BITS, false);
+    }
+}
+
+bool esc_output_streaming() {
+    for (uint8_t channel = 0; channel < esc_channel_count; channel++) {
+        const bb_esc_channel &ch = esc_channels[channel];
+        if (ch.attached && ch.digital && ch.us) return true;
+    }
+    return false;
+}
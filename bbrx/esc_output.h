@@ -0,0 +1,97 @@
+#pragma once
+
+/*
+ * servo / esc output driver, which drives the LEDC and RMT peripherals directly
+ *
+ * each output channel sends pulses using one of the bb_protocol protocols.  pulse widths are
+ * always given in µs between ESC_PWM_MIN and ESC_PWM_MAX, and the driver scales them to the
+ * protocol's pulse width (eg: an eighth of that for OneShot125).  channels using the same
+ * protocol share a LEDC timer, so their pulses start at the same time.
+ *
+ * DShot channels use an RMT channel instead.  the pulse width is turned into a DShot throttle
+ * value (ESC_PWM_MIN is zero throttle, and ESC_PWM_MAX is full throttle), which is encoded into
+ * a frame of RMT items that the peripheral clocks out by itself.
+ *
+ * writes are only stored until esc_output_flush() is called, which updates the duty cycle of
+ * every channel that changed in one go (once per control tick).  the new duty cycle is latched
+ * by the peripheral at the start of the channel's next pulse.  DShot ESCs expect a steady
+ * stream of frames, so DShot channels send a frame on every flush, whether they changed or not.
+*/
+
+#include <cstdint>
+#include "config.h"
+
+/**
+ * @brief Set up an output channel on a pin
+ *
+ * The channel doesn't send any pulses until something is written to it.
+ *
+ * @param channel which output channel (0 to ESC_MAX_CHANNELS - 1)
+ * @param pin which pin to output on
+ * @param protocol which protocol to use
+ * @return true if the channel was set up
+ */
+bool esc_output_attach(uint8_t channel, uint8_t pin, bb_protocol protocol);
+
+/**
+ * @brief Change the protocol of an output channel
+ *
+ * @param channel the output channel (which must have been attached)
+ * @param protocol which protocol to use
+ * @return true if the channel is now using the protocol
+ */
+bool esc_output_set_protocol(uint8_t channel, bb_protocol protocol);
+
+/**
+ * @brief Set the pulse width of an output channel (sent by the next esc_output_flush())
+ *
+ * @param channel the output channel (which must have been attached)
+ * @param us pulse width in µs (limited to ESC_PWM_MIN to ESC_PWM_MAX)
+ */
+void esc_output_write(uint8_t channel, int32_t us);
+
+/**
+ * @brief Get the pulse width which stops the motor on an output channel
+ *
+ * The analog protocols are used with bidirectional ESCs, which stop at ESC_PWM_MID.  DShot is
+ * used with unidirectional ESCs, and ESC_PWM_MIN is sent as a zero throttle frame.
+ *
+ * @param channel the output channel
+ * @return int32_t the pulse width in µs
+ */
+int32_t esc_output_neutral(uint8_t channel);
+
+/**
+ * @brief Build a DShot frame
+ *
+ * A frame is the 11 bit value, then the telemetry request bit, then a 4 bit checksum of the
+ * other 12 bits, and it's sent most significant bit first.
+ *
+ * @param value throttle (48-2047), or a command (0 = zero throttle, 1-47 = special commands)
+ * @param telemetry whether to ask the ESC to send telemetry
+ * @return uint16_t the frame
+ */
+uint16_t dshot_frame(uint16_t value, bool telemetry);
+
+/**
+ * @brief Convert a pulse width to a DShot throttle value
+ *
+ * @param us pulse width in µs, between ESC_PWM_MIN (zero throttle) and ESC_PWM_MAX (full throttle)
+ * @return uint16_t 0 for zero throttle, otherwise a throttle value between 48 and 2047
+ */
+uint16_t dshot_throttle(int32_t us);
+
+/**
+ * @brief Send the pulse width of every channel which has changed to the peripheral, and a frame on every DShot channel
+ *
+ * Should be called once per control tick, after everything has been written.
+ */
+void esc_output_flush();
+
+/**
+ * @brief Whether any output channel needs esc_output_flush() to be called on every tick
+ * 
+ * LEDC keeps sending the same pulse by itself, but DShot frames are only sent when the outputs
+ * are flushed, and a DShot ESC treats a gap in the frames as a lost signal.
+ */
+bool esc_output_streaming();
@@ -1,10 +1,17 @@
 
 #include <vector>
-#include <map>
-#include <ESP32Servo.h>
+#include <cmath>
 #include "event_manager.h"
 #include "controllers.h"
 #include "status_led.h"
+#include "latency.h"
+#include "scale.h"
+#include "timer_wheel.h"
+#include "mixer.h"
+#include "filters.h"
+#include "curves.h"
+#include "esc_output.h"
+#include "feedback.h"
 #include "log.h"
 #include "config.h"
 
@@ -14,42 +21,308 @@ uint16_t bind_count = 0;  // counter for the number of bindings
 
 #define LOG_TAG "events"
 
+#ifdef EVENT_LOOP_STATS
+    unsigned long loop_stats_count = 0;   // number of event manager loops since the loop rate was last reported
+    unsigned long loop_stats_start = 0;   // time at which the loop rate was last reported (ms)
+    unsigned long loop_stats_runs  = 0;   // number of bindings run since the loop rate was last reported
+    volatile bool loop_stats_reset = false;   // set to ask the event manager to reset the loop stats
+#endif
+
+// change-driven execution state (see event_manager_update())
+bb_input_snapshot previous_snapshots[BP32_MAX_GAMEPADS];   // each slot's input snapshot from the previous loop, to compare against
+uint8_t had_slots = 0;                  // bitmask of the slots which had a controller on the previous loop
+bb_input_snapshot filtered_snapshots[BP32_MAX_GAMEPADS];   // copy of each slot's input snapshot with the input filters applied
+bool refresh_pending = true;            // if true, every binding will be run on the next loop
+unsigned long last_refresh = 0;         // time at which every binding was last run (ms)
+uint64_t claims_released = 0;           // bitmask of claim slots which were released during the current loop
+bool tick_busy = true;                  // whether the last loop left something for the next one to do (see event_manager_sleep_time())
+
+/**
+ * @brief Number of servo output channels
+ * 
+ * Servo channels are numbered in the order their pins are first used by attach_servo(), and
+ * each one is an output channel of the esc output driver (see esc_output.h).  This keeps every
+ * servo output packed together, so the failsafe can just loop over them.
+ */
+uint8_t servo_channel_count = 0;
+
+/**
+ * @brief Pin-indexed table of which servo channel (if any) outputs on each pin
+ * 
+ * Elements are a servo channel, or SERVO_CHANNEL_NONE if the pin isn't used for servo output.
+ * This is indexed directly by pin number, so that finding the channel for a pin is a single
+ * array access.
+ */
+uint8_t servo_channel_of_pin[256];
+#define SERVO_CHANNEL_NONE 0xFF
+
+/**
+ * @brief Slew rate limiting state of each servo output channel, indexed by channel
+ * 
+ * Channels with a slew limit don't write their pulse straight away.  Instead, write_servo() sets
+ * the channel's target, and update_servo_slew() moves each channel's pulse towards its target
+ * once per tick, no faster than the channel's limits.  The limits are per-tick amounts worked out
+ * from the per-second amounts in the config, so they don't depend on the control loop rate.
+ */
+struct bb_servo_slew {
+    int32_t   position;                             // current pulse width (fixed point, SLEW_ONE = 1µs)
+    int32_t   target;                               // pulse width that the channel is moving towards (µs)
+    int32_t   neutral;                              // pulse width which stops the motor (µs, the midpoint unless the channel uses DShot)
+    int32_t   accelerate;                           // most the pulse can move away from the neutral point each tick (fixed point, 0 = no limit)
+    int32_t   decelerate;                           // most the pulse can move towards the neutral point each tick (fixed point, 0 = no limit)
+    uint8_t   pin;                                  // which pin the channel outputs on
+    bool      enabled;                              // whether the channel has a slew limit
+    bool      brake_bypass;                         // if true, braking skips the slew limit
+    bool      written;                              // whether the target was written this tick
+};
+bb_servo_slew servo_slew[ESC_MAX_CHANNELS];
+
+/**
+ * @brief Bitmask of the controller slots which drive each servo channel, indexed by channel
+ * 
+ * A slot drives a channel if it has a servo binding on the channel's pin, or an input of the
+ * mixer output on that pin.  This is worked out by compile_bindings(), so the failsafe only
+ * stops the channels of a slot which loses its controller.
+ */
+uint8_t servo_slots[ESC_MAX_CHANNELS];
+uint8_t failsafe_slots = 0;             // bitmask of the slots whose channels are stopped when they lose their controller (see bb_controller_config)
+
+#if defined(ENABLE_FAILSAFES) and defined(FAILSAFE_STALE_INPUT)
+    uint32_t slot_timeouts[BP32_MAX_GAMEPADS];  // how long each slot can go without a report before it's treated as having no controller (µs, 0 = forever)
+    uint8_t stale_slots = 0;                    // bitmask of the slots whose controller has stopped sending reports
+    bool timeout_pending = false;               // whether a slot with a controller will time out if it doesn't get a report
+    uint32_t timeout_deadline = 0;              // time at which the next slot will time out, if timeout_pending (µs)
+#endif
+#define SLEW_SHIFT  16
+#define SLEW_ONE    (1 << SLEW_SHIFT)
+
+#ifdef LATENCY_STATS
+    int32_t servo_pulses[ESC_MAX_CHANNELS];     // last pulse width written to each servo channel, to detect changes
+    uint32_t input_times[BP32_MAX_GAMEPADS];    // time at which each slot's current snapshot's report was received (µs)
+    uint32_t input_time = 0;                    // time at which the newest fresh report this loop was received (µs)
+    bool input_fresh = false;                   // whether any slot's snapshot is new this loop
+#endif
+
+/**
+ * @brief Set up servo output on a pin, if it isn't already set up
+ * 
+ * @param pin which pin to output on
+ * @return uint8_t the servo channel for that pin, or SERVO_CHANNEL_NONE if no more channels are available
+ */
+uint8_t attach_servo(uint8_t pin) {
+
+    // already attached?
+    if (servo_channel_of_pin[pin] != SERVO_CHANNEL_NONE) return servo_channel_of_pin[pin];
+
+    if (servo_channel_count >= ESC_MAX_CHANNELS) {
+        loge(LOG_TAG, "Can't output servo PWM on pin %d; all %d servo channels are in use", pin, ESC_MAX_CHANNELS);
+        return SERVO_CHANNEL_NONE;
+    }
+
+    // set up the output (with the default protocol; configure_outputs() sets the protocol from the config)
+    uint8_t channel = servo_channel_count;
+    if (!esc_output_attach(channel, pin, ESC_DEFAULT_PROTOCOL)) return SERVO_CHANNEL_NONE;
+    servo_channel_count++;
+
+    servo_channel_of_pin[pin] = channel;
+    int32_t neutral = esc_output_neutral(channel);
+    servo_slew[channel] = {.position = neutral * SLEW_ONE, .target = neutral, .neutral = neutral, .pin = pin};
+    logd(LOG_TAG, "Attached servo channel %d to pin %d", channel, pin);
+
+    return channel;
+}
+
+/**
+ * @brief Write a pulse width straight to a servo channel's output
+ * 
+ * The pulse width is sent to the output at the end of the tick, by esc_output_flush().
+ * 
+ * @param channel which servo channel to output on
+ * @param us pulse width in µs
+ */
+inline void output_servo(uint8_t channel, int32_t us) {
+
+    esc_output_write(channel, us);
+
+    #ifdef LATENCY_STATS
+        // if the pulse changed in response to a new report, record how long that took
+        if (us != servo_pulses[channel] && input_fresh) latency_record(channel, servo_slew[channel].pin, micros() - input_time);
+        servo_pulses[channel] = us;
+    #endif
+}
+
+/**
+ * @brief Write a pulse width to the servo output on a pin (if there is one)
+ * 
+ * If the channel has a slew limit, this sets the pulse width that the channel moves towards,
+ * and the pulse is written by update_servo_slew() at the end of the tick.
+ * 
+ * @param pin which pin to output on
+ * @param us pulse width in µs
+ * @param braking true if this is the brake stopping the output (which can skip the slew limit)
+ */
+inline void write_servo(uint8_t pin, int32_t us, bool braking = false) {
+    uint8_t channel = servo_channel_of_pin[pin];
+    if (channel == SERVO_CHANNEL_NONE) return;
+
+    bb_servo_slew &slew = servo_slew[channel];
+    slew.target = us;
+    if (slew.enabled && !(braking && slew.brake_bypass)) {
+        slew.written = true;
+        return;
+    }
+
+    slew.position = us * SLEW_ONE;
+    output_servo(channel, us);
+}
+
 /**
- * @brief Map to hold Servo objects for each pin which is used for servo output
+ * @brief Stop the motor on the servo output on a pin (if there is one), for braking
  * 
+ * @param pin which pin to output on
  */
-std::map<uint8_t, Servo> servos;
+inline void stop_servo(uint8_t pin) {
+    uint8_t channel = servo_channel_of_pin[pin];
+    if (channel == SERVO_CHANNEL_NONE) return;
+    write_servo(pin, servo_slew[channel].neutral, true);
+}
 
 /**
- * @brief Map to keep track of whether each action is claimed by which binding
+ * @brief Move the pulse of each slew limited servo channel towards its target
  * 
- * The value for this map is a pair, where the first element is a boolean indicating whether
- * the action has been claimed, and the second element is the ID of the binding
- * which has claimed it.
+ * Moving away from the neutral point (normally the midpoint) is limited by the channel's accelerate
+ * limit, and moving towards it is limited by its decelerate limit.  When the target is on the other
+ * side of the neutral point, the pulse stops there on the way past, so that it decelerates down to
+ * the neutral point and then accelerates away from it.
+ * 
+ * Should be called once per tick, after every binding has run.
+ * 
+ * @return true if any channel hasn't reached its target yet
+ */
+bool update_servo_slew() {
+
+    bool moving = false;
+
+    for (uint8_t channel = 0; channel < servo_channel_count; channel++) {
+        bb_servo_slew &slew = servo_slew[channel];
+        if (!slew.enabled) continue;
+        const int32_t mid = slew.neutral * SLEW_ONE;
+
+        int32_t position = slew.position;
+        int32_t delta = slew.target * SLEW_ONE - position;
+        if (delta == 0 && !slew.written) continue;
+        slew.written = false;
+
+        // moving towards the midpoint?
+        bool towards_mid = (position > mid && delta < 0) || (position < mid && delta > 0);
+        int32_t limit = towards_mid ? slew.decelerate : slew.accelerate;
+        if (limit != 0) delta = min(max(delta, -limit), limit);
+
+        // stop at the midpoint rather than going past it
+        if (towards_mid && ((position > mid) != (position + delta > mid))) delta = mid - position;
+
+        slew.position = position + delta;
+        output_servo(channel, (slew.position + SLEW_ONE / 2) >> SLEW_SHIFT);
+        if (slew.position != slew.target * SLEW_ONE) moving = true;
+    }
+
+    return moving;
+}
+
+/**
+ * @brief Apply the output channel settings from the config to the servo channels
  * 
- * The structure of this map is as follows:
+ * Should be called after the servo channels have been set up by initialise_binding().
+ */
+void configure_outputs() {
+
+    // reset every channel to no limits and the default protocol
+    for (uint8_t channel = 0; channel < servo_channel_count; channel++) {
+        servo_slew[channel].enabled = false;
+        servo_slew[channel].brake_bypass = true;
+        esc_output_set_protocol(channel, ESC_DEFAULT_PROTOCOL);
+    }
+
+    for (const bb_output &out : outputs) {
+        uint8_t channel = servo_channel_of_pin[out.pin];
+        if (channel == SERVO_CHANNEL_NONE) {
+            logw(LOG_TAG, "Output settings for pin %d ignored; there isn't a servo output on that pin", out.pin);
+            continue;
+        }
+
+        // work out the per-tick limits (at least the smallest fixed point step, so a small limit doesn't become no limit)
+        bb_servo_slew &slew = servo_slew[channel];
+        slew.accelerate   = out.accelerate ? max((int32_t) (((int64_t) out.accelerate * SLEW_ONE) / CONTROL_RATE), (int32_t) 1) : 0;
+        slew.decelerate   = out.decelerate ? max((int32_t) (((int64_t) out.decelerate * SLEW_ONE) / CONTROL_RATE), (int32_t) 1) : 0;
+        slew.enabled      = (slew.accelerate != 0 || slew.decelerate != 0);
+        slew.brake_bypass = out.brake_bypass;
+        slew.written      = false;
+        if (!esc_output_set_protocol(channel, out.protocol)) logw(LOG_TAG, "Servo channel %d (pin %d) can't use %s", channel, out.pin, bb_protocol_to_string(out.protocol).c_str());
+        logi(LOG_TAG, "Servo channel %d (pin %d): %s, accelerate %d µs/s, decelerate %d µs/s, brake bypass %d", channel, out.pin,
+            bb_protocol_to_string(out.protocol).c_str(), out.accelerate, out.decelerate, out.brake_bypass);
+    }
+
+    // the protocol decides where each channel stops, so channels whose protocol moved it start again from there
+    for (uint8_t channel = 0; channel < servo_channel_count; channel++) {
+        bb_servo_slew &slew = servo_slew[channel];
+        int32_t neutral = esc_output_neutral(channel);
+        if (slew.neutral == neutral) continue;
+        slew.neutral  = neutral;
+        slew.position = neutral * SLEW_ONE;
+        slew.target   = neutral;
+    }
+}
+
+/**
+ * @brief Table to keep track of whether each action is claimed by which binding
  * 
- * action_claims (map)
- * ├── key: action (bb_action)
- * └── value: (map) of each action to each pin
- *     ├── key: pin number (uint8_t)
- *     └── value: (pair) with claim info
- *         ├── first: whether there is a claim for this action on this pin (bool)
- *         └── second: id of the binding which has this claim (uint16_t)
+ * Claims are made on each combination of action and pin.  When a binding is initialised, its
+ * combination of action and pin is given a "claim slot", which is an index into this table.
+ * Bindings which use the same action on the same pin share a claim slot.
  * 
- * This structure stores claim info pairs under two keys: action and pin number.
- * This means that each claim is specific to each combination of action and 
- * pin number.
+ * Each element of the table is the ID of the binding which currently has the claim for that
+ * slot, or CLAIM_NONE if there isn't any claim.
  * 
- * To access the claim info for a specific action and pin, use the following
- * approach:
+ * To access the claim info for a binding, use the following approach:
  * 
  * ```
- * action_claims[action][pin].first  // returns whether there's a claim
- * action_claims[action][pin].second // returns which binding has the claim
+ * action_claims[bind.claim_slot] != CLAIM_NONE   // returns whether there's a claim
+ * action_claims[bind.claim_slot]                 // returns which binding has the claim
  * ```
  */
-std::map<bb_action, std::map<uint8_t, std::pair<bool, uint16_t>>> action_claims;
+uint16_t action_claims[EVENT_MAX_CLAIM_SLOTS];
+static_assert(EVENT_MAX_CLAIM_SLOTS <= 64, "claim slots are tracked in 64 bit masks");
+
+/**
+ * @brief The combination of action and pin that each claim slot has been assigned to
+ */
+std::pair<bb_action, uint8_t> claim_slot_keys[EVENT_MAX_CLAIM_SLOTS];
+uint8_t claim_slot_count = 0;   // number of claim slots which have been assigned
+
+/**
+ * @brief Find the claim slot for a combination of action and pin, assigning a new one if needed
+ * 
+ * @param action the action to get the claim slot of
+ * @param pin the pin to get the claim slot of
+ * @return uint8_t the claim slot, or CLAIM_SLOT_NONE if every slot has been used up
+ */
+uint8_t get_claim_slot(bb_action action, uint8_t pin) {
+
+    // check if this combination already has a slot
+    for (uint8_t slot = 0; slot < claim_slot_count; slot++) {
+        if (claim_slot_keys[slot].first == action && claim_slot_keys[slot].second == pin) return slot;
+    }
+
+    // otherwise assign the next free one
+    if (claim_slot_count >= EVENT_MAX_CLAIM_SLOTS) {
+        loge(LOG_TAG, "Ran out of claim slots (max %d) for action %d on pin %d", EVENT_MAX_CLAIM_SLOTS, action, pin);
+        return CLAIM_SLOT_NONE;
+    }
+
+    claim_slot_keys[claim_slot_count] = {action, pin};
+    action_claims[claim_slot_count] = CLAIM_NONE;
+    return claim_slot_count++;
+}
 
 /**
  * @brief Initialise an event binding
@@ -58,14 +331,16 @@ std::map<bb_action, std::map<uint8_t, std::pair<bool, uint16_t>>> action_claims;
  * 
  * @param b a bbrx_binding object which contains all the details of the binding
  */
-void initialise_binding(bb_binding b) {
+void initialise_binding(bb_binding &b) {
+
+    // assign the binding's combination of action and pin to a claim slot.  feedback actions
+    // output to their controller rather than to a pin, so they're claimed per controller slot
+    bool feedback = (b.action == BB_ACTION_RUMBLE || b.action == BB_ACTION_LIGHTBAR || b.action == BB_ACTION_PLAYER_LEDS);
+    b.claim_slot = get_claim_slot(b.action, feedback ? b.controller : b.pin);
     
-    // if a pin is registered for a servo action, create a servo object for that pin
+    // if a pin is registered for a servo action, set up a servo channel for that pin
     if (b.action == BB_ACTION_SERVO) {
-        Servo *servo = new Servo();
-        servo->setPeriodHertz(ESC_PWM_FREQ);
-        servo->attach(b.pin, ESC_PWM_MIN, ESC_PWM_MAX);
-        servos[b.pin] = *servo;
+        attach_servo(b.pin);
     }
 
     // if a pin is registered for a gpio action, set that pin to be an outout
@@ -74,175 +349,668 @@ void initialise_binding(bb_binding b) {
         digitalWrite(b.pin, LOW);
     }
 
-    logi(LOG_TAG, "Initialised binding %d: action=%d, event=%d, min=%d, max=%d", bind_count++, b.action, b.event, b.min, b.max);
+    logi(LOG_TAG, "Initialised binding %d: action=%d, event=%d, min=%d, max=%d, claim slot=%d", bind_count++, b.action, b.event, b.min, b.max, b.claim_slot);
 }
 
 /**
- * @brief Apply a deadzone to a controller input
+ * @brief Resolve the value of an event from an input snapshot for a given input range
  * 
- * @param input the current value of the input
- * @param dead the minimum input value to not be considered 0 (both + and -)
- * @param beef the maximum input value to not be considered max (both + and -)
- * @param min the minimum value of the range of inputs
- * @param max the maximum value of the range of inputs
+ * Inputs which are past their beefzone are stored in the snapshot as BB_INPUT_BEEF_MAX or
+ * BB_INPUT_BEEF_MIN, since the value they represent depends on the range of each binding.
+ * 
+ * @param value the value of the event from the snapshot
+ * @param range_lo the lower end of the input range, ie: min(min, max)
+ * @param range_hi the upper end of the input range, ie: max(min, max)
  * @return int32_t 
  */
-int32_t deadzone(int32_t input, int32_t dead, int32_t beef, int32_t min_value, int32_t max_value) {
-    if (input > -dead && input < dead) input = 0;
-    if (input > beef)                  input = max(min_value, max_value);
-    if (input < -beef)                 input = min(min_value, max_value);
-    // float ch1_out = ( (float)-input / 4.0 ) + 128.0;
-    // input += max;
+inline int32_t resolve_input(int32_t value, int32_t range_lo, int32_t range_hi) {
+    if (value == BB_INPUT_BEEF_MAX) return range_hi;
+    if (value == BB_INPUT_BEEF_MIN) return range_lo;
+    return value;
+}
+
+static_assert(BB_EVENT_COUNT <= 64, "events are tracked in 64 bit masks");
+
+struct bb_plan_entry;
+
+/**
+ * @brief Function which performs a receiver action for a compiled binding
+ */
+typedef void (*bb_action_handler)(int32_t event_value, const bb_plan_entry &entry);
+
+/**
+ * @brief A binding which has been "compiled" into the form used by the event manager each loop
+ * 
+ * Everything which can be worked out from the binding's config is worked out once in
+ * compile_bindings(), so each loop only has to look up the event in the input snapshot and call the
+ * resolved handler.
+ */
+struct bb_plan_entry {
+    bb_action_handler act;                          // performs the bound action
+    uint8_t   claim_slot;                           // claim slot for the binding's combination of action and pin (see action_claims)
+    int32_t   min;                                  // minimum value of the range of possible inputs
+    int32_t   max;                                  // maximum value of the range of possible inputs
+    int32_t   range_lo;                             // min(min, max), which beefzoned inputs are resolved to
+    int32_t   range_hi;                             // max(min, max), which beefzoned inputs are resolved to
+    int32_t   threshold;                            // halfway point between min and max, used by digital actions
+    bb_scale  scale;                                // precomputed transform from the input range to the action's output range (servo, speed set and feedback only)
+    int32_t   default_value;                        // the default / neutral value for the event
+    int32_t   conditional_lo;                       // min(conditional_min, conditional_max)
+    int32_t   conditional_hi;                       // max(conditional_min, conditional_max)
+    int32_t   conditional_threshold;                // halfway point between conditional_min and conditional_max
+    bool      conditional_inverted;                 // if true (conditional_min > conditional_max), conditionals pass below the threshold instead of above it
+    bool      conditional_never;                    // if true, the digital conditionals can never all pass
+    uint64_t  conditional_mask;                     // bitmask of the digital conditional events which must be in a certain state, indexed by bb_event
+    uint64_t  conditional_invert;                   // bits of conditional_mask whose events must be released rather than pressed
+    uint16_t  conditional_first;                    // index of the binding's first analog conditional event in plan_conditionals
+    uint16_t  conditional_count;                    // number of analog conditional events the binding has
+    uint16_t  bind_id;                              // index of the binding in the bindings vector
+    uint8_t   event;                                // the bound event (index into the input snapshot)
+    uint8_t   controller;                           // which controller slot's snapshot the binding's events are read from
+    bb_action action;                               // the bound action (only used for logging)
+    uint8_t   pin;                                  // which pin to use as output
+    bool      exec_without_controller;              // see bb_binding
+    bool      ignore_claims;                        // see bb_binding
+    bool      conditional_noexec;                   // see bb_binding
+    bool      always_run;                           // if true, run the binding on every loop even when change-driven (for actions which do something each time they're run)
+    bool      accumulate;                           // if true, this is a cumulative binding (see accumulate())
+    int64_t   accumulator;                          // current value of the accumulator (fixed point, ACCUMULATOR_ONE = 1)
+    int64_t   accumulate_gain;                      // amount added to the accumulator each tick per unit of input (fixed point)
+    int64_t   accumulate_decay;                     // fraction of the accumulator's distance from default_value removed each tick (fixed point, DECAY_ONE = 1)
+    int64_t   accumulate_lo;                        // lowest value of the accumulator (fixed point)
+    int64_t   accumulate_hi;                        // highest value of the accumulator (fixed point)
+    bb_trigger trigger;                             // which edges of the event the binding responds to (see trigger())
+    uint8_t   trigger_state;                        // TRIGGER_ bits for the binding's edge detector
+    uint32_t  trigger_debounce;                     // how long the event has to hold a new state before it counts (µs)
+    uint32_t  trigger_since;                        // time at which the event last changed state, while TRIGGER_PENDING is set (µs)
+    uint32_t  repeat_delay;                         // how many ticks after being pressed the binding starts repeating
+    uint32_t  repeat_period;                        // how many ticks between each repeat (fixed point, 65536 = 1 tick; 0 = don't repeat)
+    uint32_t  repeat_phase;                         // fraction of a tick left over from the last repeat (same fixed point as repeat_period)
+    const int16_t *curve;                           // the binding's response curve table (nullptr = linear, see apply_curve())
+    bb_scale  curve_below;                          // transform from range_lo..default_value to the first half of the curve table
+    bb_scale  curve_above;                          // transform from default_value..range_hi to the second half of the curve table
+    int32_t   curve_span_below;                     // distance from default_value down to range_lo
+    int32_t   curve_span_above;                     // distance from default_value up to range_hi
+    uint64_t  subscriptions;                        // bitmask of the events the binding depends on (its event and conditionals), indexed by bb_event
+    uint32_t  colour;                               // see bb_binding
+};
+
+/**
+ * @brief The compiled bindings, in the order they are executed each loop
+ */
+std::vector<bb_plan_entry> plan;
+
+/**
+ * @brief Check whether a conditional event's value passes, for a compiled binding
+ * 
+ * A conditional passes if its value is past the halfway point of the conditional range, going
+ * from conditional_min towards conditional_max.
+ * 
+ * @param entry the compiled binding
+ * @param value the (resolved) value of the conditional event
+ * @return true if the conditional passes
+ */
+inline bool conditional_passes(const bb_plan_entry &entry, int32_t value) {
+    return entry.conditional_inverted ? (value < entry.conditional_threshold) : (value > entry.conditional_threshold);
+}
+
+#define CURVE_POSITION_MID  ((CURVE_SEGMENTS / 2) << CURVE_FRAC_BITS)     // position of default_value in a curve table
+#define CURVE_POSITION_MAX  (CURVE_SEGMENTS << CURVE_FRAC_BITS)           // position of the far end of a curve table
+
+/**
+ * @brief Reshape an event value using a compiled binding's response curve
+ * 
+ * The value is limited to the binding's input range, then each side of default_value is
+ * scaled onto its own half of the curve table, so that default_value is always the middle of
+ * the curve and each end of the range is an end of the curve.  The output of the curve is
+ * scaled back the same way.
+ * 
+ * @param entry the compiled binding (which must have a curve)
+ * @param value the (resolved) event value
+ * @return int32_t the reshaped event value
+ */
+inline int32_t apply_curve(const bb_plan_entry &entry, int32_t value) {
+
+    int32_t position;
+    if (value >= entry.default_value) position = (value >= entry.range_hi) ? CURVE_POSITION_MAX : scale_apply(entry.curve_above, value);
+    else                              position = (value <= entry.range_lo) ? 0                  : scale_apply(entry.curve_below, value);
 
-    return input;
+    int64_t y = curve_apply(entry.curve, position);
+    int64_t span = (y >= 0) ? entry.curve_span_above : entry.curve_span_below;
+    return entry.default_value + (int32_t) ((y * span + (CURVE_ONE / 2)) >> CURVE_SHIFT);
 }
 
+#define ACCUMULATOR_ONE ((int64_t) 1 << 24)    // fixed-point value of 1 in cumulative binding accumulators and gains (enough fraction bits that the per-tick gain stays accurate at high loop rates)
+#define DECAY_ONE       ((int64_t) 1 << 16)    // fixed-point value of 1 in cumulative binding decays
+
 /**
- * @brief Determine the current value of a given input event
+ * @brief Run a cumulative binding's accumulator for one control tick
  * 
- * @param event the event to get the value of
- * @param controller a pointer to the controller object to get the value of
- * @return int32_t 
+ * The difference between the event value and the binding's default value is added to the
+ * accumulator (scaled by the gain), and then the accumulator decays back towards the default
+ * value.  The gain and decay are per-tick amounts which were worked out from the per-second
+ * amounts in the config and the control loop rate, so the rate at which the accumulator
+ * changes doesn't depend on the control loop rate.
+ * 
+ * @param entry the compiled binding
+ * @param event_value the value of the binding's event this tick
+ * @param connected whether a controller is connected
+ * @return int32_t the new value of the accumulator, which should be used as the binding's input instead of the event value
  */
-int32_t get_event_value(bb_event event, ControllerPtr controller, int32_t min, int32_t max) {
-
-    switch(event) {
-        case BB_EVENT_ANALOG_LX:            return deadzone(controller->axisX(),    DEADZONE_LX,       BEEFZONE_LX,       min, max);
-        case BB_EVENT_ANALOG_LY:            return deadzone(controller->axisY(),    DEADZONE_LY,       BEEFZONE_LY,       min, max);
-        case BB_EVENT_ANALOG_RX:            return deadzone(controller->axisRX(),   DEADZONE_RX,       BEEFZONE_RX,       min, max);
-        case BB_EVENT_ANALOG_RY:            return deadzone(controller->axisRY(),   DEADZONE_RY,       BEEFZONE_RY,       min, max);
-        case BB_EVENT_ANALOG_BRAKE:         return deadzone(controller->brake(),    DEADZONE_BRAKE,    BEEFZONE_BRAKE,    min, max);
-        case BB_EVENT_ANALOG_THROTTLE:      return deadzone(controller->throttle(), DEADZONE_THROTTLE, BEEFZONE_THROTTLE, min, max);
-        case BB_EVENT_GYRO_X:               return controller->gyroX();
-        case BB_EVENT_GYRO_Y:               return controller->gyroY();
-        case BB_EVENT_GYRO_Z:               return controller->gyroY();
-        case BB_EVENT_ACCEL_X:              return controller->accelX();
-        case BB_EVENT_ACCEL_Y:              return controller->accelY();
-        case BB_EVENT_ACCEL_Z:              return controller->accelZ();
-        case BB_EVENT_DPAD_UP:              return controller->dpad() & 0x01;
-        case BB_EVENT_DPAD_DOWN:            return controller->dpad() & 0x02;
-        case BB_EVENT_DPAD_LEFT:            return controller->dpad() & 0x08;
-        case BB_EVENT_DPAD_RIGHT:           return controller->dpad() & 0x04;
-        case BB_EVENT_BTN_A:                return controller->a();
-        case BB_EVENT_BTN_B:                return controller->b();
-        case BB_EVENT_BTN_X:                return controller->x();
-        case BB_EVENT_BTN_Y:                return controller->y();
-        case BB_EVENT_BTN_L1:               return controller->l1();
-        case BB_EVENT_BTN_L2:               return controller->l2();
-        case BB_EVENT_BTN_R1:               return controller->r1();
-        case BB_EVENT_BTN_R2:               return controller->r2();
-        case BB_EVENT_BTN_L3:               return controller->thumbL();
-        case BB_EVENT_BTN_R3:               return controller->thumbR();
-        case BB_EVENT_BTN_SYSTEM:           return controller->miscSystem();
-        case BB_EVENT_BTN_START:            return controller->miscStart();
-        case BB_EVENT_BTN_SELECT:           return controller->miscSelect();
-        case BB_EVENT_BTN_CAPTURE:          return controller->miscCapture();
-        case BB_EVENT_MOUSE_DX:             return controller->deltaX();
-        case BB_EVENT_MOUSE_DY:             return controller->deltaY();
-        case BB_EVENT_MOUSE_SCROLLWHEEL:    return controller->scrollWheel();
-        case BB_EVENT_WII_BB_TOP_LEFT:      return controller->topLeft();
-        case BB_EVENT_WII_BB_TOP_RIGHT:     return controller->topRight();
-        case BB_EVENT_WII_BB_BOTTOM_LEFT:   return controller->bottomLeft();
-        case BB_EVENT_WII_BB_BOTTOM_RIGHT:  return controller->bottomRight();
-        case BB_EVENT_WII_BB_TEMPERATURE:   return controller->temperature();
-        case BB_EVENT_MISC_BATTERY:         return controller->battery();
+inline int32_t accumulate(bb_plan_entry &entry, int32_t event_value, bool connected) {
 
-        default:
-            logw(LOG_TAG, "Unknown event value requested (event=%d)", event);
-            return 0;
+    int64_t neutral = (int64_t) entry.default_value * ACCUMULATOR_ONE;
+
+    // Failsafe: forget the accumulated value when nothing is connected, so the output doesn't
+    // jump back to wherever it was when a controller reconnects
+    #if defined(ENABLE_FAILSAFES) and defined(FAILSAFE_NO_CONTROLLER)
+        if (!connected) {
+            entry.accumulator = neutral;
+            return entry.default_value;
+        }
+    #endif
+
+    int64_t acc = entry.accumulator;
+    acc += ((int64_t) event_value - entry.default_value) * entry.accumulate_gain;
+
+    // the distance from neutral times the decay can be more than 64 bits once the range is over
+    // 2^23, so the whole units of DECAY_ONE and the remainder are multiplied separately (which
+    // gives exactly the same result, rounded towards zero)
+    int64_t distance  = acc - neutral;
+    int64_t magnitude = (distance < 0) ? -distance : distance;
+    int64_t decay     = (magnitude / DECAY_ONE) * entry.accumulate_decay + ((magnitude % DECAY_ONE) * entry.accumulate_decay) / DECAY_ONE;
+    acc -= (distance < 0) ? -decay : decay;
+
+    if (acc < entry.accumulate_lo) acc = entry.accumulate_lo;
+    if (acc > entry.accumulate_hi) acc = entry.accumulate_hi;
+    entry.accumulator = acc;
+
+    // round to the nearest whole value
+    return (acc >= 0) ? (acc + ACCUMULATOR_ONE / 2) / ACCUMULATOR_ONE : -((-acc + ACCUMULATOR_ONE / 2) / ACCUMULATOR_ONE);
+}
+
+/**
+ * @brief Transform from the value of each mixer output to its pulse width
+ */
+bb_scale mixer_servo_scales[MIXER_MAX_OUTPUTS];
+
+/**
+ * @brief Make the transform from an input range to the pulse widths of the servo channel on a pin
+ * 
+ * The speed limit takes the same amount off both ends of a bidirectional channel, which stops
+ * at the midpoint.  A unidirectional channel (DShot) stops at the low end, so only its top end
+ * is limited, and the bottom of the input range is always zero throttle.
+ * 
+ * @param pin the pin of the servo channel
+ * @param in_min input value which maps to the lowest pulse width
+ * @param in_max input value which maps to the highest pulse width
+ * @return bb_scale the transform
+ */
+bb_scale make_servo_scale(uint8_t pin, int32_t in_min, int32_t in_max) {
+    uint8_t channel = servo_channel_of_pin[pin];
+    int32_t neutral = (channel != SERVO_CHANNEL_NONE) ? esc_output_neutral(channel) : ESC_PWM_MID;
+    int32_t low = (neutral == ESC_PWM_MID) ? ESC_PWM_MIN + speed_limit : neutral;
+    return scale_make(in_min, in_max, low, ESC_PWM_MAX - speed_limit);
+}
+
+/**
+ * @brief Recompute the input-to-pulse transform of every servo binding and mixer output
+ * 
+ * The output range of servo bindings depends on speed_limit and on each channel's protocol, so
+ * this has to be called whenever either changes.
+ */
+void update_servo_scales() {
+    for (bb_plan_entry &entry : plan) {
+        if (entry.action == BB_ACTION_SERVO) entry.scale = make_servo_scale(entry.pin, entry.min, entry.max);
+    }
+    for (uint8_t o = 0; o < mixer_output_count; o++) {
+        mixer_servo_scales[o] = make_servo_scale(mixer_pins[o], -MIXER_ONE, MIXER_ONE);
     }
+}
 
+/**
+ * @brief Change the speed limit, and update everything that depends on it
+ * 
+ * @param limit the new speed limit
+ */
+void set_speed_limit(int16_t limit) {
+    if (limit == speed_limit) return;
+    speed_limit = limit;
+    update_servo_scales();
 }
 
+static_assert((BB_TRIGGER_RISING | BB_TRIGGER_FALLING) == BB_TRIGGER_BOTH, "trigger modes are used as bitmasks of edges");
+
+#define TRIGGER_ACTIVE  0x01        // the (debounced) event is pressed
+#define TRIGGER_PENDING 0x02        // the event has changed state, and is waiting for the debounce time to pass
+#define TRIGGER_REPEAT  0x04        // the binding's repeat timer has expired, so it should repeat its action
+
 /**
- * @brief Perform the specified action
+ * @brief Timers for repeating bindings, indexed by the binding's position in the plan
  * 
- * @param action the receiver action to perform when the event occurs
- * @param event_value the current value of the event to which the action should respond
- * @param min minimum value of the range of possible inputs
- * @param max maximum value of the range of possible inputs
- * @param pin which pin to use as output (optional)
+ * While the event of a repeating binding is held, its timer is kept scheduled for the tick of
+ * its next repeat.  The wheel is advanced once per control tick, so only the timers which are
+ * due have to be looked at, however many bindings repeat.
  */
-void perform_action(int32_t event_value, bb_binding bind, ControllerPtr controller=nullptr) {
+timer_wheel<REPEAT_WHEEL_SLOTS> repeat_timers;
+uint32_t repeat_tick = 0;           // number of control ticks run, which repeat timer deadlines are in terms of
 
-    int32_t out, input;
+/**
+ * @brief Run an edge triggered binding's edge detector for one control tick
+ * 
+ * The event is pressed when its value is past the binding's threshold (like the digital
+ * actions).  Once it has been pressed or released for the binding's debounce time, the
+ * detector changes state, and if the binding's trigger mode responds to that edge, the action
+ * is given the top of the input range for that one tick.  Every other tick, it's given the
+ * default value, so the action runs once per edge.
+ * 
+ * If the binding repeats, pressing the event also starts its repeat timer, and the action is
+ * given the top of the input range again each time the timer expires until the event is
+ * released.
+ * 
+ * @param entry the compiled binding
+ * @param event_value the value of the binding's event this tick
+ * @param now the time of this control tick (µs)
+ * @param connected whether a controller is connected
+ * @return int32_t the value which should be used as the binding's input instead of the event value
+ */
+inline int32_t trigger(bb_plan_entry &entry, int32_t event_value, uint32_t now, bool connected) {
+
+    // Failsafe: when the controller goes away, forget about the event being held rather than
+    // treating it as being released
+    #if defined(ENABLE_FAILSAFES) and defined(FAILSAFE_NO_CONTROLLER)
+        if (!connected) {
+            entry.trigger_state = 0;
+            if (entry.repeat_period != 0) repeat_timers.cancel(&entry - plan.data());
+            return entry.default_value;
+        }
+    #endif
 
-    switch(bind.action) {
-        case BB_ACTION_TEST:
+    bool active = (event_value > entry.threshold);
+    if (active == ((entry.trigger_state & TRIGGER_ACTIVE) != 0)) {
+        entry.trigger_state &= ~TRIGGER_PENDING;
 
-            // map input to boolean
-            if (event_value > ((bind.max - bind.min) / 2) + bind.min) {
-                logd(LOG_TAG, "event manager test!!! pin=%d", bind.pin);
-            }
+        // repeat the action if the repeat timer has expired
+        if (entry.trigger_state & TRIGGER_REPEAT) {
+            entry.trigger_state &= ~TRIGGER_REPEAT;
+            if (active) return entry.range_hi;
+        }
+        return entry.default_value;
+    }
+
+    // the event has changed state; wait for it to settle
+    if (!(entry.trigger_state & TRIGGER_PENDING)) {
+        entry.trigger_state |= TRIGGER_PENDING;
+        entry.trigger_since = now;
+    }
+    if (now - entry.trigger_since < entry.trigger_debounce) return entry.default_value;
+
+    entry.trigger_state = active ? TRIGGER_ACTIVE : 0;
+
+    // start repeating when pressed, and stop when released
+    if (entry.repeat_period != 0) {
+        uint16_t index = &entry - plan.data();
+        if (active) {
+            entry.repeat_phase = 0;
+            repeat_timers.schedule(index, repeat_tick + entry.repeat_delay);
+        }
+        else repeat_timers.cancel(index);
+    }
+
+    return (entry.trigger & (active ? BB_TRIGGER_RISING : BB_TRIGGER_FALLING)) ? entry.range_hi : entry.default_value;
+}
 
-            break;
+/**
+ * @brief Analog conditional events of every compiled binding
+ * 
+ * Each plan entry refers to a contiguous slice of this vector, so that the conditionals of all
+ * the bindings are packed together instead of each binding having its own vector.  Digital
+ * conditionals aren't stored here, since they're compiled into each entry's conditional_mask.
+ */
+std::vector<uint8_t> plan_conditionals;
+
+//-------------------------------------------
+// action handlers
+//-------------------------------------------
+// each of these implements one receiver action.  event_value is the current value of the
+// event to which the action should respond, and entry is the compiled binding being run.
+
+void action_test(int32_t event_value, const bb_plan_entry &entry) {
+
+    // map input to boolean
+    if (event_value > entry.threshold) {
+        logd(LOG_TAG, "event manager test!!! pin=%d", entry.pin);
+    }
+
+}
+
+void action_debug_value(int32_t event_value, const bb_plan_entry &entry) {
+    logd(LOG_TAG, "value=%d", event_value);
+}
+
+void action_servo(int32_t event_value, const bb_plan_entry &entry) {
+
+    int32_t out = scale_apply(entry.scale, event_value);
+    logv(LOG_TAG, "servo out: raw: %d, scaled: %d", event_value, out);
+    
+    // write channel output
+    if (brake) stop_servo(entry.pin);
+    else       write_servo(entry.pin, out);
+
+}
+
+void action_speed_up(int32_t event_value, const bb_plan_entry &entry) {
+
+    if (event_value > entry.threshold) {
+        int16_t limit = speed_limit - 1;
+        if (limit < 0) limit = 0;
+        set_speed_limit(limit);
+        refresh_pending = true;
+        logi(LOG_TAG, "Decreasing speed restriction to %d", speed_limit);
+    }
+
+}
+
+void action_speed_down(int32_t event_value, const bb_plan_entry &entry) {
+
+    if (event_value > entry.threshold) {
+        int16_t limit = speed_limit + 1;
+        if (limit > (ESC_PWM_MAX-ESC_PWM_MIN)/2) limit = (ESC_PWM_MAX-ESC_PWM_MIN)/2;
+        set_speed_limit(limit);
+        refresh_pending = true;
+        logi(LOG_TAG, "Increasing speed restriction to %d", speed_limit);
+    }
+
+}
+
+void action_speed_set(int32_t event_value, const bb_plan_entry &entry) {
+
+    int32_t out = scale_apply(entry.scale, event_value);
+    logv(LOG_TAG, "speed set: raw: %d, scaled: %d", event_value, out);
+    if (out != speed_limit) refresh_pending = true;
+    set_speed_limit(out);
+
+}
+
+void action_brake(int32_t event_value, const bb_plan_entry &entry) {
+
+    bool input = (event_value > entry.threshold);
+    if (!brake && input) {
+        logi(LOG_TAG, "Breaking!");
+        leds_request_state(LED_BRAKE);
+    }
+    if (brake && !input) {
+        logi(LOG_TAG, "Stepping off the breaks...");
+        leds_request_state_previous();
+    }
+
+    if (brake != input) refresh_pending = true;
+    brake = input;
+
+}
+
+void action_gpio(int32_t event_value, const bb_plan_entry &entry) {
+    digitalWrite(entry.pin, event_value > entry.threshold);
+}
+
+// the feedback actions only ask for feedback, which is sent to the binding's controller later
+// by the main loop, so they never wait for bluetooth
 
-        case BB_ACTION_DEBUG_VALUE:
-            logd(LOG_TAG, "value=%d", event_value);
-            break;
+void action_rumble(int32_t event_value, const bb_plan_entry &entry) {
 
-        case BB_ACTION_SERVO:
+    int32_t strength = scale_apply(entry.scale, event_value);
+    feedback_request(entry.controller, FEEDBACK_RUMBLE, min(max(strength, 0), 255));
 
-            out = map(event_value, bind.min, bind.max, ESC_PWM_MIN + speed_limit, ESC_PWM_MAX - speed_limit);
-            logv(LOG_TAG, "servo out: raw: %d, scaled: %d", event_value, out);
-            
-            // write channel output
-            if (brake) servos[bind.pin].writeMicroseconds(ESC_PWM_MID);
-            else       servos[bind.pin].writeMicroseconds(out);
+}
+
+void action_lightbar(int32_t event_value, const bb_plan_entry &entry) {
+
+    // blend from the default colour at the bottom of the input range to the binding's colour at the top
+    int32_t amount = min(max(scale_apply(entry.scale, event_value), 0), 255);
+    uint32_t from = feedback_default(entry.controller, FEEDBACK_COLOUR);
+    uint32_t colour = 0;
+    for (uint8_t shift = 0; shift <= 16; shift += 8) {
+        int32_t a = (from >> shift) & 0xFF;
+        int32_t b = (entry.colour >> shift) & 0xFF;
+        colour |= (uint32_t) (a + (b - a) * amount / 255) << shift;
+    }
+    feedback_request(entry.controller, FEEDBACK_COLOUR, colour);
+
+}
+
+void action_player_leds(int32_t event_value, const bb_plan_entry &entry) {
+
+    // light up a bar of LEDs, or show the controller's slot at the bottom of the input range
+    int32_t lit = min(max(scale_apply(entry.scale, event_value), 0), FEEDBACK_PLAYER_LED_COUNT);
+    feedback_request(entry.controller, FEEDBACK_PLAYER_LEDS, lit ? (1 << lit) - 1 : feedback_default(entry.controller, FEEDBACK_PLAYER_LEDS));
+
+}
+
+/**
+ * @brief Determine which handler performs a given receiver action
+ * 
+ * @param action the action to get the handler of
+ * @return bb_action_handler, or nullptr if the action isn't supported
+ */
+bb_action_handler resolve_action_handler(bb_action action) {
+
+    switch(action) {
+        case BB_ACTION_TEST:        return action_test;
+        case BB_ACTION_DEBUG_VALUE: return action_debug_value;
+        case BB_ACTION_SERVO:       return action_servo;
+        case BB_ACTION_SPEED_UP:    return action_speed_up;
+        case BB_ACTION_SPEED_DOWN:  return action_speed_down;
+        case BB_ACTION_SPEED_SET:   return action_speed_set;
+        case BB_ACTION_BRAKE:       return action_brake;
+        case BB_ACTION_GPIO:        return action_gpio;
+        case BB_ACTION_RUMBLE:      return action_rumble;
+        case BB_ACTION_LIGHTBAR:    return action_lightbar;
+        case BB_ACTION_PLAYER_LEDS: return action_player_leds;
+
+        default:
+            logw(LOG_TAG, "Unsupported action (action=%d)", action);
+            return nullptr;
+    }
+
+}
+
+/**
+ * @brief Compile the registered bindings into the plan run by event_manager_update()
+ * 
+ * Should be called once after all the bindings have been loaded and initialised.  Bindings with
+ * an unsupported action or event are left out of the plan (with a warning).  The bindings vector
+ * must not be changed after this is called, unless this is called again.
+ */
+void compile_bindings() {
+
+    plan.clear();
+    plan_conditionals.clear();
+    curves_clear();
+    plan.reserve(bindings.size());
+    uint16_t conditional_total = 0;
+
+    for (uint16_t bind_id = 0; bind_id < bindings.size(); bind_id++) {
 
+        bb_binding &bind = bindings[bind_id];
+        bb_plan_entry entry;
 
-            break;
+        entry.act        = resolve_action_handler(bind.action);
+        entry.claim_slot = bind.claim_slot;
+        if (bind.event >= BB_EVENT_COUNT) logw(LOG_TAG, "Unknown event (event=%d)", bind.event);
+        if (bind.event >= BB_EVENT_COUNT || entry.act == nullptr || entry.claim_slot == CLAIM_SLOT_NONE) {
+            logw(LOG_TAG, "Leaving binding %d out of the event plan", bind_id);
+            continue;
+        }
 
-        case BB_ACTION_SPEED_UP:
-            if (event_value > ((bind.max - bind.min) / 2) + bind.min) {
-                speed_limit--;
-                if (speed_limit < 0) speed_limit = 0;
-                logi(LOG_TAG, "Decreasing speed restriction to %d", speed_limit);
+        entry.event                   = bind.event;
+        entry.min                     = bind.min;
+        entry.max                     = bind.max;
+        entry.range_lo                = min(bind.min, bind.max);
+        entry.range_hi                = max(bind.min, bind.max);
+        entry.threshold               = ((bind.max - bind.min) / 2) + bind.min;
+        entry.default_value           = bind.default_value;
+        entry.conditional_lo          = min(bind.conditional_min, bind.conditional_max);
+        entry.conditional_hi          = max(bind.conditional_min, bind.conditional_max);
+        entry.conditional_threshold   = ((bind.conditional_max - bind.conditional_min) / 2) + bind.conditional_min;
+        entry.conditional_inverted    = (bind.conditional_min > bind.conditional_max);
+        entry.bind_id                 = bind_id;
+        entry.action                  = bind.action;
+        entry.pin                     = bind.pin;
+        entry.controller              = bind.controller;
+        entry.exec_without_controller = bind.exec_without_controller;
+        entry.ignore_claims           = bind.ignore_claims;
+        entry.conditional_noexec      = bind.conditional_noexec;
+        entry.colour                  = bind.colour;
+
+        // compile the binding's conditionals.  digital ones (buttons and the d-pad) can only be
+        // pressed or released, so they're turned into a bitmask of the state each one has to be in.
+        // analog ones are packed onto the end of the shared conditionals vector
+        entry.conditional_never  = false;
+        entry.conditional_mask   = 0;
+        entry.conditional_invert = 0;
+        entry.conditional_first  = plan_conditionals.size();
+        entry.subscriptions      = 1ULL << entry.event;
+
+        for (bb_event evt : bind.conditionals) {
+
+            if (evt >= BB_EVENT_COUNT) {
+                logw(LOG_TAG, "Unknown conditional event (event=%d)", evt);
+                continue;
             }
-            break;
-
-        case BB_ACTION_SPEED_DOWN:
-            // logv(LOG_TAG, "im tired value=%d min=%d max=%d", event_value, bind.min, bind.max);
-            if (event_value > ((bind.max - bind.min) / 2) + bind.min) {
-                speed_limit++;
-                if (speed_limit > (ESC_PWM_MAX-ESC_PWM_MIN)/2) speed_limit = (ESC_PWM_MAX-ESC_PWM_MIN)/2;
-                logi(LOG_TAG, "Increasing speed restriction to %d", speed_limit);
+            entry.subscriptions |= 1ULL << evt;
+            conditional_total++;
+
+            if (!BB_EVENT_IS_DIGITAL(evt)) {
+                plan_conditionals.push_back(evt);
+                continue;
             }
-            break;
 
-        case BB_ACTION_SPEED_SET:
+            // work out whether the conditional passes when the event is pressed, and when it's released
+            bool pass_pressed  = conditional_passes(entry, controller_pressed_value(evt));
+            bool pass_released = conditional_passes(entry, 0);
+            uint64_t bit = 1ULL << evt;
 
-            out = map(event_value, bind.min, bind.max, 0, (ESC_PWM_MAX-ESC_PWM_MIN)/2);
-            logv(LOG_TAG, "speed set: raw: %d, scaled: %d", event_value, out);
-            speed_limit = out;
-            break;
+            if (pass_pressed && pass_released) continue;        // always passes, so doesn't need to be checked
+            if (!pass_pressed && !pass_released) {              // never passes
+                entry.conditional_never = true;
+                continue;
+            }
 
-        case BB_ACTION_BRAKE:
+            // the same event can't be required to be both pressed and released
+            bool invert = pass_released;
+            if ((entry.conditional_mask & bit) && (((entry.conditional_invert & bit) != 0) != invert)) entry.conditional_never = true;
 
-            input = (event_value > ((bind.max - bind.min) / 2) + bind.min);
-            if (!brake && input) {
-                logi(LOG_TAG, "Breaking!");
-                leds_set_state(LED_BRAKE);
-            }
-            if (brake && !input) {
-                logi(LOG_TAG, "Stepping off the breaks...");
-                leds_set_state_previous();
+            entry.conditional_mask |= bit;
+            if (invert) entry.conditional_invert |= bit;
+        }
+        entry.conditional_count = plan_conditionals.size() - entry.conditional_first;
+
+        entry.always_run = (bind.action == BB_ACTION_SPEED_UP || bind.action == BB_ACTION_SPEED_DOWN);
+
+        // cumulative bindings.  these integrate every tick, so they always have to be run
+        entry.accumulate = bind.accumulate;
+        if (bind.accumulate) {
+            entry.always_run       = true;
+            entry.accumulator      = (int64_t) bind.default_value * ACCUMULATOR_ONE;
+            entry.accumulate_gain  = llround((double) bind.accumulate_gain  * ACCUMULATOR_ONE / CONTROL_RATE);
+            entry.accumulate_decay = llround((double) bind.accumulate_decay * DECAY_ONE / CONTROL_RATE);
+            if (entry.accumulate_decay < 0)         entry.accumulate_decay = 0;
+            if (entry.accumulate_decay > DECAY_ONE) entry.accumulate_decay = DECAY_ONE;     // can't decay by more than the whole distance in one tick
+            entry.accumulate_lo    = (int64_t) min(bind.accumulate_min, bind.accumulate_max) * ACCUMULATOR_ONE;
+            entry.accumulate_hi    = (int64_t) max(bind.accumulate_min, bind.accumulate_max) * ACCUMULATOR_ONE;
+        }
+
+        // edge triggered bindings.  these have to be run every tick to see when the event has
+        // been stable for long enough, and so the action's input goes back to default after an edge
+        entry.trigger          = bind.trigger;
+        entry.trigger_state    = 0;
+        entry.trigger_debounce = (uint32_t) bind.debounce * 1000;
+        entry.trigger_since    = 0;
+        entry.repeat_period    = 0;
+
+        // repeating bindings.  repeats are counted from the event being pressed, so a level
+        // triggered binding becomes rising edge triggered (otherwise it'd run every tick anyway)
+        if (bind.repeat_rate > 0) {
+            if (entry.trigger == BB_TRIGGER_LEVEL) entry.trigger = BB_TRIGGER_RISING;
+            if (!(entry.trigger & BB_TRIGGER_RISING)) {
+                logw(LOG_TAG, "Binding %d isn't triggered by its event being pressed, so it can't repeat", bind_id);
+            } else {
+                // can't repeat more than once a tick
+                int64_t period = llround((double) CONTROL_RATE * 65536 / bind.repeat_rate);
+                entry.repeat_period = min(max(period, (int64_t) 65536), (int64_t) UINT32_MAX);
+                entry.repeat_delay  = max((uint32_t) bind.repeat_delay * CONTROL_RATE / 1000, (uint32_t) 1);
+                entry.repeat_phase  = 0;
             }
+        }
+        if (entry.trigger != BB_TRIGGER_LEVEL) entry.always_run = true;
+
+        // response curve.  the curve's table is shared with any other binding that has the same curve
+        entry.curve = curve_make(bind.expo, bind.curve);
+        if (entry.curve != nullptr) {
+            entry.curve_below      = scale_make(entry.range_lo, bind.default_value, 0, CURVE_POSITION_MID);
+            entry.curve_above      = scale_make(bind.default_value, entry.range_hi, CURVE_POSITION_MID, CURVE_POSITION_MAX);
+            entry.curve_span_below = max(bind.default_value - entry.range_lo, 0);
+            entry.curve_span_above = max(entry.range_hi - bind.default_value, 0);
+        }
 
-            brake = input;
+        // precompute the transform from the input range to the output range, so the action doesn't have to divide
+        // (servo bindings are done below, since they depend on the speed limit)
+        if (bind.action == BB_ACTION_SPEED_SET) entry.scale = scale_make(bind.min, bind.max, 0, (ESC_PWM_MAX-ESC_PWM_MIN)/2);
+        if (bind.action == BB_ACTION_RUMBLE || bind.action == BB_ACTION_LIGHTBAR) entry.scale = scale_make(bind.min, bind.max, 0, 255);
+        if (bind.action == BB_ACTION_PLAYER_LEDS) entry.scale = scale_make(bind.min, bind.max, 0, FEEDBACK_PLAYER_LED_COUNT);
 
-            break;
+        plan.push_back(entry);
+    }
 
-        case BB_ACTION_GPIO:
-            input = (event_value > ((bind.max - bind.min) / 2) + bind.min);
-            digitalWrite(bind.pin, (bool) input);
-            break;
+    // set up the input filters
+    filters_compile();
+
+    // set up the mixer, and a servo channel for each of its outputs
+    mixer_compile();
+    for (uint8_t o = 0; o < mixer_output_count; o++) {
+        attach_servo(mixer_pins[o]);
+        for (const bb_binding &bind : bindings) {
+            if (bind.action == BB_ACTION_SERVO && bind.pin == mixer_pins[o]) {
+                logw(LOG_TAG, "Pin %d is a mixer output, so servo bindings on it will be overridden by the mixer", bind.pin);
+                break;
+            }
+        }
+    }
 
+    // apply the output channel settings (which depend on the control loop rate)
+    configure_outputs();
 
-        default:
-            logw(LOG_TAG, "Tried to call unsupported action (action=%d)", bind.action);
+    // work out which controller slots drive each servo channel, for the failsafe
+    memset(servo_slots, 0, sizeof(servo_slots));
+    for (const bb_plan_entry &entry : plan) {
+        uint8_t channel = servo_channel_of_pin[entry.pin];
+        if (entry.action == BB_ACTION_SERVO && channel != SERVO_CHANNEL_NONE) servo_slots[channel] |= 1 << entry.controller;
+    }
+    for (uint8_t o = 0; o < mixer_output_count; o++) {
+        uint8_t channel = servo_channel_of_pin[mixer_pins[o]];
+        if (channel != SERVO_CHANNEL_NONE) servo_slots[channel] |= mixer_controllers[o];
     }
+    failsafe_slots = (1 << BP32_MAX_GAMEPADS) - 1;
+    for (const bb_controller_config &config : controller_configs) {
+        if (!config.failsafe) failsafe_slots &= ~(1 << config.slot);
+    }
+    #if defined(ENABLE_FAILSAFES) and defined(FAILSAFE_STALE_INPUT)
+        memset(slot_timeouts, 0, sizeof(slot_timeouts));
+        for (const bb_controller_config &config : controller_configs) {
+            slot_timeouts[config.slot] = (uint32_t) config.timeout * 1000;
+        }
+        stale_slots = 0;
+    #endif
+
+    // one repeat timer per binding (nothing is scheduled until a binding's event is pressed)
+    repeat_timers.resize(plan.size());
+    repeat_tick = 0;
 
+    // make sure every binding runs at least once
+    update_servo_scales();
+    refresh_pending = true;
+
+    logi(LOG_TAG, "Compiled %d of %d bindings (%d conditionals, %d analog)", (int) plan.size(), (int) bindings.size(), conditional_total, (int) plan_conditionals.size());
 }
 
 /**
@@ -251,123 +1019,380 @@ void perform_action(int32_t event_value, bb_binding bind, ControllerPtr controll
  */
 void event_manager_setup() {
 
-    // setup servo pwm
-    ESP32PWM::allocateTimer(0);
-	ESP32PWM::allocateTimer(1);
-	ESP32PWM::allocateTimer(2);
-	ESP32PWM::allocateTimer(3);
+    // no pins have servo channels yet
+    memset(servo_channel_of_pin, SERVO_CHANNEL_NONE, sizeof(servo_channel_of_pin));
+
+}
+
+/**
+ * @brief Work out which slots have a controller which is still sending reports
+ * 
+ * Failsafe: a controller which stops sending reports without disconnecting (eg: because of
+ * interference, or its firmware locking up) would otherwise leave the outputs running on its
+ * last report.  So a slot with a timeout which hasn't had a report for that long is treated as
+ * if it had no controller, until its next report arrives.
+ * 
+ * This also works out when the next slot will time out, so the control loop can wake up for it.
+ * 
+ * @param frame the latest snapshot of every slot
+ * @param now the time of this control tick (µs)
+ * @return uint8_t bitmask of the slots which have a controller that hasn't timed out
+ */
+uint8_t live_slots(const bb_input_frame &frame, uint32_t now) {
+
+    uint8_t live = frame.connected;
+
+    #if defined(ENABLE_FAILSAFES) and defined(FAILSAFE_STALE_INPUT)
+
+        timeout_pending = false;
+        for (uint8_t slot = 0; slot < BP32_MAX_GAMEPADS; slot++) {
+            uint8_t bit = 1 << slot;
+            if (!(frame.connected & bit) || slot_timeouts[slot] == 0) continue;
+
+            uint32_t age = now - frame.slots[slot].time;
+            if (age >= slot_timeouts[slot]) {
+                live &= ~bit;
+                continue;
+            }
+
+            uint32_t deadline = now + (slot_timeouts[slot] - age);
+            if (!timeout_pending || (int32_t) (deadline - timeout_deadline) < 0) timeout_deadline = deadline;
+            timeout_pending = true;
+        }
+
+        // only slots which still have a controller can be stale
+        uint8_t stale = frame.connected & ~live;
+        for (uint8_t slot = 0; slot < BP32_MAX_GAMEPADS; slot++) {
+            uint8_t bit = 1 << slot;
+            if ((stale & bit) && !(stale_slots & bit)) logw(LOG_TAG, "Controller in slot %d stopped sending reports; treating it as disconnected", slot);
+            if ((stale_slots & bit) && (live & bit)) logi(LOG_TAG, "Controller in slot %d is sending reports again", slot);
+        }
+        stale_slots = stale;
+
+    #endif
 
+    return live;
 }
 
 /**
  * @brief Check controller input and perform bound actions
  * 
+ * Each binding reads its events from the snapshot of its controller slot, so several controllers
+ * can drive different bindings at once.  Bindings whose slot has no controller (or whose
+ * controller has timed out, see live_slots()) see their default values, which releases any claims
+ * they hold.
+ * 
+ * Normally every binding is run on every loop.  When EVENT_CHANGE_DRIVEN is enabled, each slot's
+ * input snapshot is compared against its previous one, and only the bindings which depend on an
+ * event that changed in their slot are run.  Every binding of a slot is run when a controller
+ * connects to or disconnects from it, and every binding is still run when:
+ * - an action changes some state that other bindings' outputs depend on (speed limit, brake)
+ * - EVENT_REFRESH_PERIOD ms have passed since every binding was last run (if not 0)
+ * 
+ * Bindings sharing a claim slot are also re-run when the slot's claim is released (both later in
+ * the same loop and on the next loop), so that another binding can take over the claim.
  */
 void event_manager_update() {
 
-    // handle controller input
-    controller_handle([&](ControllerPtr controller) {
+    #ifdef EVENT_LOOP_STATS
+        // count loops (the loop rate is reported by event_manager_log_stats())
+        if (loop_stats_reset) {
+            loop_stats_count = 0;
+            loop_stats_runs = 0;
+            loop_stats_reset = false;
+        }
+        loop_stats_count++;
+    #endif
+
+    // get the latest input from every controller slot, and work out which slots still have a
+    // controller which is sending reports
+    const bb_input_frame &frame = controller_read();
+    uint32_t now = micros();            // time of this tick, for debouncing and timeouts
+    uint8_t connected = live_slots(frame, now);
+
+    // whether anything this loop does means the next loop has to run, even if there's no new input
+    bool busy = false;
+
+    // filter the inputs once, before anything looks at them.  slots without a controller
+    // have no snapshot
+    const bb_input_snapshot *snapshots[BP32_MAX_GAMEPADS];
+    for (uint8_t slot = 0; slot < BP32_MAX_GAMEPADS; slot++) {
+        snapshots[slot] = (connected & (1 << slot)) ? &frame.slots[slot] : nullptr;
+        if (!filter_count) continue;
+        if (snapshots[slot] != nullptr) {
+            filtered_snapshots[slot] = frame.slots[slot];
+            if (filters_apply(filtered_snapshots[slot], slot)) busy = true;
+            snapshots[slot] = &filtered_snapshots[slot];
+        }
+        else filters_reset(slot);
+    }
+
+    // work out which bindings need to be run this loop.  bindings are tracked by the events
+    // they depend on in each slot
+    bool run_all = !EVENT_CHANGE_DRIVEN || refresh_pending;
+    uint64_t changed_events[BP32_MAX_GAMEPADS] = {};
+    uint64_t changed_claims = claims_released;
+
+    if (EVENT_CHANGE_DRIVEN) {
+
+        for (uint8_t slot = 0; slot < BP32_MAX_GAMEPADS; slot++) {
+            const bb_input_snapshot *snapshot = snapshots[slot];
 
-        // for each binding
-        for (uint16_t bind_id = 0; bind_id < bindings.size(); bind_id++) {
+            // a controller connecting or disconnecting changes every event in its slot
+            if ((snapshot != nullptr) != ((had_slots & (1 << slot)) != 0)) changed_events[slot] = ~0ULL;
 
-            // get reference to binding object
-            bb_binding &bind = bindings[bind_id];
+            // compare each event against the previous snapshot
+            if (snapshot != nullptr) {
+                for (uint8_t evt = 0; evt < BB_EVENT_COUNT; evt++) {
+                    if (snapshot->values[evt] != previous_snapshots[slot].values[evt]) changed_events[slot] |= 1ULL << evt;
+                }
+                previous_snapshots[slot] = *snapshot;
+            }
+        }
+
+        // periodic refresh
+        if (EVENT_REFRESH_PERIOD != 0 && millis() - last_refresh >= EVENT_REFRESH_PERIOD) run_all = true;
+    }
 
-            // first check if the action hasn't yet already been claimed by another binding
-            // or if the action is claimed by this binding
-            // (or if the binding ignores claims just resolve as true)
-            if ((!action_claims[bind.action][bind.pin].first) || 
-                ( action_claims[bind.action][bind.pin].second == bind_id) || 
-                bind.ignore_claims
-            ) {
+    #ifdef LATENCY_STATS
+        // only pulse changes caused by a new report count towards the latency
+        input_fresh = false;
+        for (uint8_t slot = 0; slot < BP32_MAX_GAMEPADS; slot++) {
+            if (snapshots[slot] == nullptr || snapshots[slot]->time == input_times[slot]) continue;
+            input_times[slot] = snapshots[slot]->time;
+            if (!input_fresh || (int32_t) (input_times[slot] - input_time) > 0) input_time = input_times[slot];
+            input_fresh = true;
+        }
+    #endif
 
-                // variable for storing value of the bound event
-                int32_t event_value = bind.default_value;
+    // expire repeat timers which are due this tick, and schedule their next repeat
+    repeat_tick++;
+    repeat_timers.advance(repeat_tick, [](uint16_t index) {
+        bb_plan_entry &entry = plan[index];
+        entry.trigger_state |= TRIGGER_REPEAT;
 
-                // flag to indicate whether any of the conditional event checks have failed
-                bool conditionals_passed = true;
+        uint64_t next = (uint64_t) entry.repeat_phase + entry.repeat_period;
+        entry.repeat_phase = next & 0xFFFF;
+        repeat_timers.schedule(index, repeat_tick + (next >> 16));
+    });
+    if (run_all) last_refresh = millis();
+    had_slots = connected;
+    refresh_pending = false;
+    claims_released = 0;
+
+    // for each compiled binding
+    for (bb_plan_entry &entry : plan) {
+
+        // skip bindings whose inputs haven't changed (if change-driven)
+        if (!run_all && !entry.always_run &&
+            !(changed_events[entry.controller] & entry.subscriptions) &&
+            !((changed_claims | claims_released) & (1ULL << entry.claim_slot))
+        ) continue;
+
+        #ifdef EVENT_LOOP_STATS
+            loop_stats_runs++;
+        #endif
 
-                // if controller is connected
-                if (controller != nullptr) {
+        uint16_t &claim = action_claims[entry.claim_slot];
+        const bb_input_snapshot *snapshot = snapshots[entry.controller];
 
-                    // check if each conditional event is true
-                    for (bb_event evt : bind.conditionals) {
-                        
-                        // get value of the conditional event
-                        int32_t evt_val = get_event_value(evt, controller, bind.conditional_min, bind.conditional_max);
+        // first check if the action hasn't yet already been claimed by another binding
+        // or if the action is claimed by this binding
+        // (or if the binding ignores claims just resolve as true)
+        if ((claim == CLAIM_NONE) || 
+            (claim == entry.bind_id) || 
+            entry.ignore_claims
+        ) {
 
-                        // is the event value greater than the halfway point between min and max?
-                        bool input = (evt_val > ((bind.max - bind.min) / 2) + bind.min);
+            // variable for storing value of the bound event
+            int32_t event_value = entry.default_value;
 
-                        // if no, assume the conditional has failed
-                        if (!input) conditionals_passed = false;
-                    }
+            // flag to indicate whether any of the conditional event checks have failed
+            bool conditionals_passed = true;
 
-                    if (conditionals_passed) {
-                        // determine the event value from the event type
-                        event_value = get_event_value(bind.event, controller, bind.min, bind.max);
-                    } // otherwise assume the default
+            // if the binding's controller is connected
+            if (snapshot != nullptr) {
 
-                } // otherwise assume the default
+                // check the digital conditionals all at once.  each event in the mask must be
+                // pressed, or released if its bit is set in conditional_invert
+                conditionals_passed = !entry.conditional_never &&
+                    ((snapshot->pressed ^ entry.conditional_invert) & entry.conditional_mask) == entry.conditional_mask;
 
-                // set claim flag if not already claimed
-                // but only if the input is non-default
-                if (event_value != bind.default_value) {
-                    if (!action_claims[bind.action][bind.pin].first) {
-                        action_claims[bind.action][bind.pin].first = true;
-                        action_claims[bind.action][bind.pin].second = bind_id;
-                        logd(LOG_TAG, "Action %d on pin %d claimed by binding %d", bind.action, bind.pin, bind_id);
-                    }
-                }
-                // if the input _is_ the default, assume the action has been unclaimed
-                // (but only if this is the claimant binding)
-                else if (action_claims[bind.action][bind.pin].second == bind_id) {
-                    if (action_claims[bind.action][bind.pin].first) {
-                        action_claims[bind.action][bind.pin].first = false;
-                        action_claims[bind.action][bind.pin].second = 0;
-                        logd(LOG_TAG, "Action %d on pin %d unclaimed by binding %d", bind.action, bind.pin, bind_id);
-                    }
+                // then check each analog conditional against the threshold
+                const uint8_t *conditional = plan_conditionals.data() + entry.conditional_first;
+                for (uint16_t i = 0; conditionals_passed && i < entry.conditional_count; i++) {
+                    int32_t evt_val = resolve_input(snapshot->values[conditional[i]], entry.conditional_lo, entry.conditional_hi);
+                    if (!conditional_passes(entry, evt_val)) conditionals_passed = false;
                 }
 
-                // if the action should be performed, as per the conditional checks
-                // if noexec=false, it always runs the action
-                // if noexec=true,  it only runs the action if the checks succeed
-                if (conditionals_passed || !bind.conditional_noexec) {
+                if (conditionals_passed) {
+                    // determine the event value from the event type
+                    event_value = resolve_input(snapshot->values[entry.event], entry.range_lo, entry.range_hi);
 
-                    // perform the action if controller is connected, or exec without controller is enabled for this binding
-                    if ((controller != nullptr) || bind.exec_without_controller) {
+                    // reshape it using the binding's response curve
+                    if (entry.curve != nullptr) event_value = apply_curve(entry, event_value);
+                } // otherwise assume the default
+
+            } // otherwise assume the default
+
+            // cumulative bindings use the accumulated value rather than the event value.  once
+            // the input and the output are both back at the default, the accumulator can only
+            // decay towards the default, which doesn't change the output any more
+            if (entry.accumulate) {
+                int64_t accumulator = entry.accumulator;
+                int32_t input = event_value;
+                event_value = accumulate(entry, event_value, snapshot != nullptr);
+                if (entry.accumulator != accumulator && (input != entry.default_value || event_value != entry.default_value)) busy = true;
+            }
+
+            // edge triggered bindings only pass on the edges of the event.  an edge has to go
+            // back to the default on the next loop, and a debounce has to be timed out
+            if (entry.trigger != BB_TRIGGER_LEVEL) {
+                event_value = trigger(entry, event_value, now, snapshot != nullptr);
+                if (event_value != entry.default_value || (entry.trigger_state & TRIGGER_PENDING)) busy = true;
+            }
 
-                        logv(LOG_TAG, "acting value=%d", event_value);
-                        // Serial.printf("%d\t", event_value);
-                        perform_action(event_value, bind, controller);
-                        
-                    }
+            // set claim flag if not already claimed
+            // but only if the input is non-default
+            if (event_value != entry.default_value) {
+                if (claim == CLAIM_NONE) {
+                    claim = entry.bind_id;
+                    logd(LOG_TAG, "Action %d on pin %d claimed by binding %d", entry.action, entry.pin, entry.bind_id);
                 }
+            }
+            // if the input _is_ the default, assume the action has been unclaimed
+            // (but only if this is the claimant binding)
+            else if (claim == entry.bind_id) {
+                claim = CLAIM_NONE;
+                claims_released |= 1ULL << entry.claim_slot;
+                logd(LOG_TAG, "Action %d on pin %d unclaimed by binding %d", entry.action, entry.pin, entry.bind_id);
+            }
+
+            // if the action should be performed, as per the conditional checks
+            // if noexec=false, it always runs the action
+            // if noexec=true,  it only runs the action if the checks succeed
+            if (conditionals_passed || !entry.conditional_noexec) {
+
+                // perform the action if controller is connected, or exec without controller is enabled for this binding
+                if ((snapshot != nullptr) || entry.exec_without_controller) {
 
+                    logv(LOG_TAG, "acting value=%d", event_value);
+                    entry.act(event_value, entry);
+                    
+                }
             }
 
         }
 
-        // Serial.println("");
+    }
 
-    });
+    // mix the inputs into the mixer outputs.  this is done after the bindings, so that
+    // the mixer outputs use the speed limit and brake state they set this tick
+    if (connected && mixer_output_count) {
+        mixer_update(snapshots);
+        for (uint8_t o = 0; o < mixer_output_count; o++) {
+            if (brake) stop_servo(mixer_pins[o]);
+            else       write_servo(mixer_pins[o], scale_apply(mixer_servo_scales[o], mixer_values[o]));
+        }
+    }
 
-    // if no controllers are connected
-    if (!controller_connected()) {
+    // move slew limited servo channels towards the pulses the bindings and mixer wrote
+    if (update_servo_slew()) busy = true;
+
+    // Failsafe: kill the motors driven by controllers which aren't connected (or have timed out)
+    // (this uses the frame rather than controller_connected(), so it agrees with the input the bindings just used)
+    #if defined(ENABLE_FAILSAFES) and defined(FAILSAFE_NO_CONTROLLER)
+
+        // a channel is stopped when a slot it depends on has lost its controller, or when
+        // nothing is connected at all (which also covers channels no slot drives)
+        uint8_t lost = failsafe_slots & ~connected;
+        for (uint8_t channel = 0; channel < servo_channel_count; channel++) {
+            if (!(servo_slots[channel] & lost) && (servo_slots[channel] != 0 || connected != 0)) continue;
+
+            // write the neutral value to each servo motor (ie: turn it off; for DShot, this is a zero throttle frame)
+            // this skips the slew limit, and the channel will accelerate from there when a controller reconnects
+            bb_servo_slew &slew = servo_slew[channel];
+            esc_output_write(channel, slew.neutral);
+            slew.position = slew.neutral * SLEW_ONE;
+            slew.target   = slew.neutral;
+            slew.written  = false;
+
+            #ifdef LATENCY_STATS
+                // (the failsafe isn't a response to a report, so it isn't recorded, but the next change is measured from here)
+                servo_pulses[channel] = slew.neutral;
+            #endif
+        }
 
-        // Failsafe: kill motors when nothing is connected
-        #if defined(ENABLE_FAILSAFES) and defined(FAILSAFE_NO_CONTROLLER)
+    #endif
 
-            // for each servo {don't}
-            for (auto it = servos.begin(); it != servos.end(); ++it) {
+    // send this tick's pulse widths to the outputs, all at once
+    esc_output_flush();
 
-                // write midpoint value to each servo motor (ie: turn it off)
-                it->second.writeMicroseconds(ESC_PWM_MID);
-            }
+    // the next loop also has work to do if this one asked for a refresh or released a claim, if
+    // there are repeats to count, or if there are outputs which have to be sent every tick
+    tick_busy = busy || refresh_pending || claims_released || repeat_timers.any_scheduled() || esc_output_streaming();
 
-        #endif
+}
+
+/**
+ * @brief Work out how long the event manager can go without running, if there's no new input
+ * 
+ * Running a loop without any new input normally does exactly the same as the last loop did, so
+ * there's no need to run it.  The exceptions are when the last loop left something for the next
+ * one to do, like a slew limited output which hasn't reached its target, a filter which hasn't
+ * settled, an edge triggered binding which has to go back to its default, or a DShot output
+ * which has to be sent every tick.  The periodic refresh (if change-driven) also has to run, and
+ * a controller which stops sending reports has to be noticed when it times out.
+ * 
+ * Should be called by the control task after event_manager_update().
+ * 
+ * @return uint32_t how long until the next loop has to run (ms), 0 if it has to run on the next
+ * tick, or EVENT_SLEEP_FOREVER if it only has to run when there's new input
+ */
+uint32_t event_manager_sleep_time() {
 
+    if (tick_busy) return 0;
+
+    uint32_t sleep = EVENT_SLEEP_FOREVER;
+    if (EVENT_CHANGE_DRIVEN && EVENT_REFRESH_PERIOD != 0) {
+        unsigned long since = millis() - last_refresh;
+        if (since >= EVENT_REFRESH_PERIOD) return 0;
+        sleep = EVENT_REFRESH_PERIOD - since;
     }
 
-}
\ No newline at end of file
+    #if defined(ENABLE_FAILSAFES) and defined(FAILSAFE_STALE_INPUT)
+        if (timeout_pending) {
+            int32_t left = timeout_deadline - micros();
+            if (left <= 0) return 0;
+            sleep = min(sleep, (uint32_t) (left + 999) / 1000);
+        }
+    #endif
+
+    return sleep;
+}
+
+/**
+ * @brief Log the event manager's loop rate, if it's time to
+ * 
+ * This should be called from the main loop rather than the control task, so that logging doesn't
+ * eat into the time available for each control tick.
+ */
+void event_manager_log_stats() {
+
+    #ifdef EVENT_LOOP_STATS
+
+        if (millis() - loop_stats_start < EVENT_LOOP_STATS_PERIOD) return;
+
+        unsigned long elapsed = millis() - loop_stats_start;
+        unsigned long count = loop_stats_count;
+        unsigned long runs = loop_stats_runs;
+        loop_stats_reset = true;
+        loop_stats_start = millis();
+        if (count == 0) return;
+
+        logi(LOG_TAG, "loop rate: %lu Hz over %lu ms (%d bindings, %lu.%02lu run per loop)", (count * 1000UL) / elapsed, elapsed, (int) plan.size(),
+            runs / count, ((runs * 100) / count) % 100);
+
+    #endif
+
+}
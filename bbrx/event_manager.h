@@ -7,6 +7,15 @@
 
 #include "bb_enums.h"
 
+/**
+ * @brief A control point of a binding's response curve
+ * 
+ */
+struct bb_curve_point {
+    float     x;                                    // input, from -1 (the end of the range furthest below default_value) to +1 (the end furthest above it)
+    float     y;                                    // output, on the same scale as x
+};
+
 /**
  * @brief Struct to hold details for each binding
  * 
@@ -18,15 +27,99 @@ struct bb_binding {
     int32_t   max;                                  // maximum value of the range of possible inputs
     int32_t   default_value;                        // the default / neural position value for the event (for when no controller is connected and detecting when inputs are neutral)
     uint8_t   pin;                                  // which pin to use as output
+    uint8_t   controller;                           // which controller slot the binding's event and conditionals are read from
     bool      exec_without_controller;              // whether to execute the action if a controller isn't connected (with event value = 0)
     bool      ignore_claims;                        // if true, execute the bound action even if it is claimed by another binding
     std::vector<bb_event> conditionals;             // array of events which must evaluate as true before the action can be called
     int32_t   conditional_min;                      // minimum value of the range of inputs that the conditional event(s) could have
     int32_t   conditional_max;                      // maximum value of the range of inputs that the conditional event(s) could have
     bool      conditional_noexec;                   // if true, don't run the action when conditionals fail (otherwise do run with default value)
+    bool      accumulate;                           // if true, the event value is added to an accumulator every control tick, and the accumulator is used as the action's input
+    float     accumulate_gain;                      // how fast the accumulator changes; each second, it changes by gain * (event value - default_value)
+    float     accumulate_decay;                     // how fast the accumulator returns to default_value; each second, it moves back by decay * its distance from default_value
+    int32_t   accumulate_min;                       // lowest value the accumulator can have
+    int32_t   accumulate_max;                       // highest value the accumulator can have
+    bb_trigger trigger;                             // whether the action responds to the event's level, or only to it being pressed and/or released
+    uint16_t  debounce;                             // how long the event has to stay pressed or released before an edge counts (ms, edge triggered bindings only)
+    float     repeat_rate;                          // while the event is held, how many times a second to repeat the action (0 = don't repeat)
+    uint16_t  repeat_delay;                         // how long the event has to be held before it starts repeating (ms)
+    float     expo;                                 // how much to soften the response around default_value (0 = linear, 1 = cubic)
+    std::vector<bb_curve_point> curve;              // control points of a custom response curve (used instead of expo if not empty)
+    uint32_t  colour;                               // (BB_ACTION_LIGHTBAR) lightbar colour at the top of the input range (0xRRGGBB)
+    uint8_t   claim_slot;                           // index into the action claims table for the binding's action and pin (assigned by initialise_binding(), not loaded from config)
+};
+// note: if adding members to this struct make sure to add code in config.cpp:parse_config() to interpret the param from the config yaml file
+
+/**
+ * @brief Struct to hold the settings for each output channel
+ * 
+ */
+struct bb_output {
+    uint8_t   pin;                                  // which pin the settings are for
+    int32_t   accelerate;                           // fastest the pulse can move away from the midpoint (µs per second, 0 = no limit)
+    int32_t   decelerate;                           // fastest the pulse can move towards the midpoint (µs per second, 0 = no limit)
+    bool      brake_bypass;                         // if true, braking sets the pulse to the midpoint straight away rather than decelerating
+    bb_protocol protocol;                           // how the pulse is sent to the esc
+};
+// note: if adding members to this struct make sure to add code in config.cpp:parse_config() to interpret the param from the config yaml file
+
+/**
+ * @brief Struct to hold the settings for each input to the mixer
+ * 
+ */
+struct bb_mixer_input {
+    bb_event  event;                                // the event to use as an input
+    uint8_t   controller;                           // which controller slot the event is read from
+    int32_t   min;                                  // value of the event which counts as -1
+    int32_t   max;                                  // value of the event which counts as +1
+};
+
+/**
+ * @brief Struct to hold the settings for each output of the mixer
+ * 
+ */
+struct bb_mixer_output {
+    uint8_t   pin;                                  // which pin to output servo pwm on
+    std::vector<float> weights;                     // how much of each mixer input (in the same order as the inputs) to add together
+    float     clamp;                                // largest magnitude the output can have (0 to 1, where 1 is full throw)
+    float     expo;                                 // how much to soften the output around the centre (0 = linear, 1 = cubic)
+    bool      reverse;                              // if true, the output is reversed
+};
+// note: if adding members to these structs make sure to add code in config.cpp:parse_config() to interpret the param from the config yaml file
+
+/**
+ * @brief Struct to hold the settings for each input filter stage
+ * 
+ */
+struct bb_filter_config {
+    bb_event  event;                                // the event to filter
+    uint8_t   controller;                           // which controller slot's event to filter
+    bb_filter type;                                 // which filter to use
+    float     alpha;                                // (BB_FILTER_EMA) how much of each new value to mix in (0 to 1; smaller = smoother)
+    uint8_t   taps;                                 // (BB_FILTER_MEDIAN) how many values to take the median of (3 or 5)
+    float     cutoff;                               // (BB_FILTER_LOWPASS) cutoff frequency (Hz)
+    float     q;                                    // (BB_FILTER_LOWPASS) Q factor (0.707 is the flattest)
+};
+// note: if adding members to this struct make sure to add code in config.cpp:parse_config() to interpret the param from the config yaml file
+
+/**
+ * @brief Struct to hold the settings for each controller slot
+ * 
+ */
+struct bb_controller_config {
+    uint8_t   slot;                                 // which controller slot the settings are for
+    bool      failsafe;                             // if true, the servo outputs driven by this slot are stopped when it has no controller
+    uint16_t  timeout;                              // if not 0, the slot is treated as having no controller while it hasn't had a report for this long (ms)
 };
 // note: if adding members to this struct make sure to add code in config.cpp:parse_config() to interpret the param from the config yaml file
 
-void initialise_binding(bb_binding b);
+#define CLAIM_NONE          0xFFFF                  // value of a claim slot which isn't claimed by any binding
+#define CLAIM_SLOT_NONE     0xFF                    // claim slot of a binding which couldn't be given one
+#define EVENT_SLEEP_FOREVER UINT32_MAX              // returned by event_manager_sleep_time() when nothing will happen until there's new input
+
+void initialise_binding(bb_binding &b);
+void compile_bindings();
 void event_manager_setup();
-void event_manager_update();
\ No newline at end of file
+void event_manager_update();
+uint32_t event_manager_sleep_time();
+void event_manager_log_stats();
\ No newline at end of file
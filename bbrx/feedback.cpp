@@ -0,0 +1,120 @@
+#include <atomic>
+#include <Arduino.h>
+#include <Bluepad32.h>
+#include "feedback.h"
+#include "controllers.h"
+#include "log.h"
+#include "config.h"
+
+#define LOG_TAG "feedback"
+
+/**
+ * @brief Latest requested feedback of a controller slot
+ *
+ * Each channel's value is written by whichever task asks for it, and the changed bit is set
+ * afterwards, so when feedback_update() clears the bit it always sees the latest value.
+ */
+struct bb_feedback_slot {
+    std::atomic<uint32_t> values[FEEDBACK_CHANNELS];    // latest requested value of each channel
+    std::atomic<uint8_t>  changed;                      // bitmask of the channels which have changed since they were last sent
+    unsigned long rumble_sent;                          // (main loop) time at which the rumble was last sent (ms)
+};
+
+bb_feedback_slot feedback_slots[BP32_MAX_GAMEPADS];
+unsigned long feedback_last_send = 0;                   // time at which feedback was last sent (ms)
+
+#ifdef FEEDBACK_STATS
+    std::atomic<uint32_t> feedback_requested(0);        // number of requests which changed a channel
+    uint32_t feedback_sent = 0;                         // number of commands sent to controllers
+    uint32_t feedback_requested_logged = 0;             // value of feedback_requested when the stats were last logged
+    unsigned long feedback_stats_last_log = 0;          // time at which the stats were last logged (ms)
+#endif
+
+uint32_t feedback_default(uint8_t slot, bb_feedback_channel channel) {
+    switch (channel) {
+        case FEEDBACK_COLOUR:       return FEEDBACK_DEFAULT_COLOUR;
+        case FEEDBACK_PLAYER_LEDS:  return 1 << slot;
+        default:                    return 0;
+    }
+}
+
+void feedback_request(uint8_t slot, bb_feedback_channel channel, uint32_t value) {
+
+    if (slot >= BP32_MAX_GAMEPADS) return;
+    bb_feedback_slot &s = feedback_slots[slot];
+
+    // only the latest value of each channel is kept, so a request just replaces the last one
+    if (s.values[channel].exchange(value, std::memory_order_relaxed) == value) return;
+    s.changed.fetch_or(1 << channel, std::memory_order_release);
+
+    #ifdef FEEDBACK_STATS
+        feedback_requested.fetch_add(1, std::memory_order_relaxed);
+    #endif
+}
+
+void feedback_reset(uint8_t slot) {
+
+    if (slot >= BP32_MAX_GAMEPADS) return;
+    bb_feedback_slot &s = feedback_slots[slot];
+
+    for (uint8_t channel = 0; channel < FEEDBACK_CHANNELS; channel++) {
+        s.values[channel].store(feedback_default(slot, (bb_feedback_channel) channel), std::memory_order_relaxed);
+    }
+    s.changed.store((1 << FEEDBACK_CHANNELS) - 1, std::memory_order_release);
+}
+
+void feedback_update() {
+
+    if (millis() - feedback_last_send < FEEDBACK_PERIOD) return;
+    feedback_last_send = millis();
+
+    for (uint8_t slot = 0; slot < BP32_MAX_GAMEPADS; slot++) {
+        bb_feedback_slot &s = feedback_slots[slot];
+        uint8_t changed = s.changed.exchange(0, std::memory_order_acquire);
+
+        // feedback for a slot without a controller is dropped (it's all sent again when one connects)
+        ControllerPtr ctl = controller_get(slot);
+        if (ctl == nullptr) continue;
+
+        // each rumble only lasts for FEEDBACK_RUMBLE_DURATION, so one which is still going has to be resent before it runs out
+        uint32_t rumble = s.values[FEEDBACK_RUMBLE].load(std::memory_order_relaxed);
+        if (rumble != 0 && millis() - s.rumble_sent >= FEEDBACK_RUMBLE_DURATION / 2) changed |= 1 << FEEDBACK_RUMBLE;
+
+        if (changed & (1 << FEEDBACK_RUMBLE)) {
+            ctl->playDualRumble(0, FEEDBACK_RUMBLE_DURATION, rumble, rumble);
+            s.rumble_sent = millis();
+        }
+        if (changed & (1 << FEEDBACK_COLOUR)) {
+            uint32_t colour = s.values[FEEDBACK_COLOUR].load(std::memory_order_relaxed);
+            ctl->setColorLED((colour >> 16) & 0xFF, (colour >> 8) & 0xFF, colour & 0xFF);
+        }
+        if (changed & (1 << FEEDBACK_PLAYER_LEDS)) {
+            ctl->setPlayerLEDs(s.values[FEEDBACK_PLAYER_LEDS].load(std::memory_order_relaxed));
+        }
+
+        #ifdef FEEDBACK_STATS
+            feedback_sent += __builtin_popcount(changed);
+        #endif
+    }
+
+}
+
+void feedback_log_stats() {
+
+    #ifdef FEEDBACK_STATS
+
+        if (millis() - feedback_stats_last_log < FEEDBACK_STATS_PERIOD) return;
+        feedback_stats_last_log = millis();
+
+        // requests which were replaced by a newer one before they were sent were coalesced
+        uint32_t requested = feedback_requested.load(std::memory_order_relaxed);
+        logi(LOG_TAG, "%lu feedback changes requested, %lu commands sent",
+            (unsigned long) (requested - feedback_requested_logged),
+            (unsigned long) feedback_sent
+        );
+        feedback_requested_logged = requested;
+        feedback_sent = 0;
+
+    #endif
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+/*
+ * controller feedback (rumble, lightbar colour and player LEDs)
+ *
+ * sending feedback to a controller queues Bluetooth output, which can take a while, so the
+ * control loop never does it itself.  instead, it asks for feedback with feedback_request(),
+ * which just stores the latest value of each feedback channel of each controller slot.
+ * feedback_update() (run by the main loop, which has the lowest priority) sends the channels
+ * which have changed, at most once every FEEDBACK_PERIOD.  so if a channel changes several
+ * times in between, only its latest value is sent.
+*/
+
+#include <cstdint>
+
+#define FEEDBACK_PLAYER_LED_COUNT   4       // number of player LEDs a controller can have
+
+/**
+ * @brief The kinds of feedback which can be sent to each controller
+ */
+enum bb_feedback_channel {
+    FEEDBACK_RUMBLE,                        // strength of both rumble motors (0 to 255, 0 = off)
+    FEEDBACK_COLOUR,                        // lightbar colour (0xRRGGBB)
+    FEEDBACK_PLAYER_LEDS,                   // bitmask of the player LEDs which are lit
+    FEEDBACK_CHANNELS
+};
+
+/**
+ * @brief Ask for some feedback to be sent to the controller in a slot
+ *
+ * This never waits for Bluetooth, so it's safe to call from the control task (or any other).
+ * Asking for the value a channel already has does nothing.
+ *
+ * @param slot the controller slot to send the feedback to
+ * @param channel which kind of feedback it is
+ * @param value the value of the channel (see bb_feedback_channel)
+ */
+void feedback_request(uint8_t slot, bb_feedback_channel channel, uint32_t value);
+
+/**
+ * @brief Put every feedback channel of a slot back to its default, and send them all again
+ *
+ * Should be called when a controller connects to the slot.  By default, the lightbar is
+ * FEEDBACK_DEFAULT_COLOUR, the player LEDs show the slot, and there's no rumble.
+ *
+ * @param slot the controller slot
+ */
+void feedback_reset(uint8_t slot);
+
+/**
+ * @brief Get the default value of a feedback channel of a slot
+ *
+ * @param slot the controller slot
+ * @param channel which kind of feedback
+ * @return uint32_t the value the channel has when nothing has asked for any feedback
+ */
+uint32_t feedback_default(uint8_t slot, bb_feedback_channel channel);
+
+/**
+ * @brief Send the feedback which has changed to each controller, if it's time to
+ *
+ * Should be called from the main loop.
+ */
+void feedback_update();
+
+/**
+ * @brief Log how much feedback was asked for and sent, if it's time to.  Should be called from the main loop.
+ */
+void feedback_log_stats();
@@ -0,0 +1,270 @@
+#include <Arduino.h>
+#include <cmath>
+#include "filters.h"
+#include "log.h"
+
+#define LOG_TAG "filters"
+
+#define FILTER_VALUE_SHIFT  8       // fractional bits of the values kept in ema and low-pass state
+#define FILTER_ALPHA_SHIFT  16      // fractional bits of ema alpha
+#define FILTER_COEFF_SHIFT  30      // fractional bits of low-pass coefficients
+
+/**
+ * @brief State of a filter stage
+ */
+struct bb_filter_stage {
+    uint8_t   event;                                // the event the stage filters
+    uint8_t   controller;                           // which controller slot's event the stage filters
+    bb_filter type;                                 // which filter the stage applies
+    bool      primed;                               // whether the stage has seen a value since it was reset
+    uint8_t   steady;                               // number of ticks in a row the stage's output hasn't changed (up to FILTER_SETTLE_TICKS)
+    int32_t   output;                               // the stage's last output
+    uint8_t   taps;                                 // (median) number of values to take the median of
+    uint8_t   pos;                                  // (median) where the next value goes in history
+    int32_t   beef;                                 // beefzone of the event (0 if it doesn't have one)
+    int32_t   alpha;                                // (ema) fixed point, with FILTER_ALPHA_SHIFT fractional bits
+    int64_t   b0, b1, b2, a1, a2;                   // (low-pass) coefficients, normalised so a0 = 1, with FILTER_COEFF_SHIFT fractional bits
+    int32_t   history[5];                           // ema: [0] = output.  median: the last taps values.  low-pass: x[n-1], x[n-2], y[n-1], y[n-2], rounding error
+    #ifdef FILTER_STATS
+        uint32_t cycles;                            // cpu cycles spent in the stage
+        uint32_t runs;                              // number of times the stage has run
+    #endif
+};
+
+bb_filter_stage filter_arena[FILTER_MAX_STAGES];    // every compiled filter stage, in the order they're applied
+uint8_t filter_count = 0;                           // number of stages in the arena
+
+#ifdef FILTER_STATS
+    volatile bool filter_stats_reset = false;       // set to ask the control task to reset the stats
+    unsigned long filter_stats_last_log = 0;        // time at which the stats were last logged (ms)
+#endif
+
+/**
+ * @brief Get the beefzone of an event, so that beefzoned values can be filtered
+ *
+ * @return int32_t the beefzone, or 0 if the event doesn't have one
+ */
+static int32_t filter_beefzone(uint8_t event) {
+    switch (event) {
+        case BB_EVENT_ANALOG_LX:        return BEEFZONE_LX;
+        case BB_EVENT_ANALOG_LY:        return BEEFZONE_LY;
+        case BB_EVENT_ANALOG_RX:        return BEEFZONE_RX;
+        case BB_EVENT_ANALOG_RY:        return BEEFZONE_RY;
+        case BB_EVENT_ANALOG_BRAKE:     return BEEFZONE_BRAKE;
+        case BB_EVENT_ANALOG_THROTTLE:  return BEEFZONE_THROTTLE;
+        default:                        return 0;
+    }
+}
+
+void filters_compile() {
+
+    filter_count = 0;
+
+    for (const bb_filter_config &config : filters) {
+
+        if (filter_count >= FILTER_MAX_STAGES) {
+            logw(LOG_TAG, "Only %d filter stages are supported; ignoring the rest", FILTER_MAX_STAGES);
+            break;
+        }
+        if (config.event >= BB_EVENT_COUNT || BB_EVENT_IS_DIGITAL(config.event)) {
+            logw(LOG_TAG, "Can't filter event %d; only analog events can be filtered", config.event);
+            continue;
+        }
+
+        bb_filter_stage stage = {};
+        stage.event = config.event;
+        stage.controller = config.controller;
+        stage.type  = config.type;
+        stage.beef  = filter_beefzone(config.event);
+
+        switch (config.type) {
+
+            case BB_FILTER_EMA: {
+                float alpha = std::isnan(config.alpha) ? 1 : std::min(std::max(config.alpha, 0.0f), 1.0f);
+                stage.alpha = max(lroundf(alpha * (1 << FILTER_ALPHA_SHIFT)), 1L);
+                logi(LOG_TAG, "Filter stage %d: ema on event %d (controller %d), alpha %.3f", filter_count, config.event, config.controller, alpha);
+                break;
+            }
+
+            case BB_FILTER_MEDIAN:
+                stage.taps = (config.taps >= 5) ? 5 : 3;
+                if (config.taps != stage.taps) logw(LOG_TAG, "Median filters can only have 3 or 5 taps, using %d", stage.taps);
+                logi(LOG_TAG, "Filter stage %d: %d tap median on event %d (controller %d)", filter_count, stage.taps, config.event, config.controller);
+                break;
+
+            case BB_FILTER_LOWPASS: {
+                // coefficients from the audio eq cookbook (https://www.w3.org/TR/audio-eq-cookbook/),
+                // sampled at the control loop rate
+                double fs = CONTROL_RATE;
+                double cutoff = std::min(std::max((double) config.cutoff, 0.1), fs * 0.45);
+                double q = (config.q > 0) ? config.q : M_SQRT1_2;
+                double w0 = 2 * M_PI * cutoff / fs;
+                double alpha = sin(w0) / (2 * q);
+                double a0 = 1 + alpha;
+                double one = (double) (1LL << FILTER_COEFF_SHIFT);
+                stage.b0 = llround(((1 - cos(w0)) / 2) / a0 * one);
+                stage.b1 = llround((1 - cos(w0)) / a0 * one);
+                stage.b2 = stage.b0;
+                stage.a1 = llround((-2 * cos(w0)) / a0 * one);
+                stage.a2 = llround((1 - alpha) / a0 * one);
+                logi(LOG_TAG, "Filter stage %d: low-pass on event %d (controller %d), cutoff %.1f Hz, q %.3f", filter_count, config.event, config.controller, cutoff, q);
+                break;
+            }
+
+            default:
+                logw(LOG_TAG, "Unknown filter type %d", config.type);
+                continue;
+        }
+
+        filter_arena[filter_count++] = stage;
+    }
+
+    for (uint8_t i = 0; i < filter_count; i++) filter_arena[i].primed = false;
+}
+
+void filters_reset(uint8_t controller) {
+    for (uint8_t i = 0; i < filter_count; i++) {
+        if (filter_arena[i].controller == controller) filter_arena[i].primed = false;
+    }
+}
+
+/**
+ * @brief Run one filter stage on one value
+ *
+ * @param stage the filter stage
+ * @param x the value (with beefzoned values already resolved)
+ * @return int32_t the filtered value
+ */
+static inline int32_t filter_run(bb_filter_stage &stage, int32_t x) {
+
+    int32_t *h = stage.history;
+
+    switch (stage.type) {
+
+        case BB_FILTER_EMA: {
+            int32_t in = x * (1 << FILTER_VALUE_SHIFT);
+            if (!stage.primed) h[0] = in;
+            h[0] += ((int64_t) (in - h[0]) * stage.alpha) >> FILTER_ALPHA_SHIFT;
+            return (h[0] + (1 << (FILTER_VALUE_SHIFT - 1))) >> FILTER_VALUE_SHIFT;
+        }
+
+        case BB_FILTER_MEDIAN: {
+            if (!stage.primed) {
+                for (uint8_t i = 0; i < stage.taps; i++) h[i] = x;
+                stage.pos = 0;
+            }
+            h[stage.pos] = x;
+            if (++stage.pos >= stage.taps) stage.pos = 0;
+
+            // insertion sort a copy (there are at most 5 values)
+            int32_t sorted[5];
+            for (uint8_t i = 0; i < stage.taps; i++) {
+                int32_t v = h[i];
+                uint8_t j = i;
+                for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+                sorted[j] = v;
+            }
+            return sorted[stage.taps / 2];
+        }
+
+        case BB_FILTER_LOWPASS: {
+            // direct form 1, with the history kept in fixed point so small changes aren't lost.
+            // the bits lost when the output is rounded are carried over to the next output (error
+            // feedback), otherwise the output gets stuck short of the input at low cutoffs
+            int32_t in = x * (1 << FILTER_VALUE_SHIFT);
+            if (!stage.primed) {
+                h[0] = h[1] = h[2] = h[3] = in;
+                h[4] = 0;
+            }
+            int64_t acc = stage.b0 * in + stage.b1 * h[0] + stage.b2 * h[1] - stage.a1 * h[2] - stage.a2 * h[3] + h[4];
+            int32_t out = acc >> FILTER_COEFF_SHIFT;
+            h[4] = acc - ((int64_t) out << FILTER_COEFF_SHIFT);
+            h[1] = h[0];
+            h[0] = in;
+            h[3] = h[2];
+            h[2] = out;
+            return (out + (1 << (FILTER_VALUE_SHIFT - 1))) >> FILTER_VALUE_SHIFT;
+        }
+
+        default:
+            return x;
+    }
+}
+
+bool filters_apply(bb_input_snapshot &snapshot, uint8_t controller) {
+
+    bool settling = false;
+
+    #ifdef FILTER_STATS
+        if (filter_stats_reset) {
+            for (uint8_t i = 0; i < filter_count; i++) filter_arena[i].cycles = filter_arena[i].runs = 0;
+            filter_stats_reset = false;
+        }
+    #endif
+
+    for (uint8_t i = 0; i < filter_count; i++) {
+        bb_filter_stage &stage = filter_arena[i];
+        if (stage.controller != controller) continue;
+
+        #ifdef FILTER_STATS
+            uint32_t start = ESP.getCycleCount();
+        #endif
+
+        // beefzoned values are filtered as if they were just past the beefzone, and anything that
+        // comes out past the beefzone is marked as beefzoned again
+        int32_t x = snapshot.values[stage.event];
+        if      (x == BB_INPUT_BEEF_MAX) x = stage.beef + 1;
+        else if (x == BB_INPUT_BEEF_MIN) x = -stage.beef - 1;
+
+        // a stage has settled once its output has caught up with its input and stayed there for
+        // FILTER_SETTLE_TICKS.  a slow filter's output can sit still for a while as it gets going
+        // or creeps up on its input, so a still output isn't enough on its own (except for an ema
+        // whose steps have rounded down to nothing, which never catches up).  the state isn't
+        // compared, since the low-pass's rounding error can keep cycling after the output has stopped
+        int32_t ema = stage.history[0];
+        int32_t y = filter_run(stage, x);
+        bool caught_up = (y == x) || (stage.type == BB_FILTER_EMA && stage.history[0] == ema);
+        if (!stage.primed || y != stage.output || !caught_up) stage.steady = 0;
+        else if (stage.steady < FILTER_SETTLE_TICKS) stage.steady++;
+        if (stage.steady < FILTER_SETTLE_TICKS) settling = true;
+        stage.output = y;
+        stage.primed = true;
+
+        if (stage.beef) {
+            if      (y >  stage.beef) y = BB_INPUT_BEEF_MAX;
+            else if (y < -stage.beef) y = BB_INPUT_BEEF_MIN;
+        }
+        snapshot.values[stage.event] = y;
+
+        #ifdef FILTER_STATS
+            stage.cycles += ESP.getCycleCount() - start;
+            stage.runs++;
+        #endif
+    }
+
+    return settling;
+}
+
+void filters_log_stats() {
+
+    #ifdef FILTER_STATS
+
+        if (millis() - filter_stats_last_log < FILTER_STATS_PERIOD) return;
+        filter_stats_last_log = millis();
+        if (filter_count == 0) return;
+
+        uint32_t mhz = ESP.getCpuFreqMHz();
+        for (uint8_t i = 0; i < filter_count; i++) {
+            const bb_filter_stage &stage = filter_arena[i];
+            uint32_t runs = stage.runs;
+            uint32_t cycles = stage.cycles;
+            if (runs == 0) continue;
+            logi(LOG_TAG, "stage %d (%s on %s): %lu runs, mean %lu cycles (%lu ns)", i,
+                bb_filter_to_string(stage.type).c_str(), bb_event_to_string(stage.event).c_str(),
+                (unsigned long) runs, (unsigned long) (cycles / runs), (unsigned long) ((cycles / runs) * 1000 / mhz));
+        }
+        filter_stats_reset = true;
+
+    #endif
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+/*
+ * input filters, which smooth out noisy events before the bindings see them
+ *
+ * each filter stage applies one filter (see bb_filter) to one event of one controller slot, and
+ * an event can have several stages, which are applied in the order they're listed in the config.  every stage
+ * keeps its state in a fixed arena, and everything is done in fixed point.  the filters run
+ * once per control tick on a copy of the input snapshot, so each event is filtered once no
+ * matter how many bindings use it, and the filters are sampled at CONTROL_RATE.
+*/
+
+#include <cstdint>
+#include "controllers.h"
+#include "config.h"
+
+/**
+ * @brief Number of filter stages which were compiled by filters_compile()
+ */
+extern uint8_t filter_count;
+
+/**
+ * @brief Compile the filter stages from the config into the filter arena
+ *
+ * Should be called after the config has been loaded.  This also resets every filter.
+ */
+void filters_compile();
+
+/**
+ * @brief Filter the events in a controller slot's snapshot, in place
+ *
+ * Should be called once per control tick while the slot has a controller.
+ *
+ * @param snapshot the snapshot whose events should be filtered
+ * @param controller which controller slot the snapshot is from
+ * @return true if any of the slot's filters haven't settled yet (their output hasn't caught up with their input, or has changed in the last FILTER_SETTLE_TICKS ticks)
+ */
+bool filters_apply(bb_input_snapshot &snapshot, uint8_t controller);
+
+/**
+ * @brief Forget the history of every filter on a controller slot, so they start again from the next value
+ *
+ * Should be called while the slot has no controller.
+ *
+ * @param controller the controller slot
+ */
+void filters_reset(uint8_t controller);
+
+/**
+ * @brief Log how long each filter stage takes, if it's time to.  Should be called from the main loop.
+ */
+void filters_log_stats();
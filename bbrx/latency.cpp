@@ -0,0 +1,75 @@
+#include <Arduino.h>
+#include "latency.h"
+#include "log.h"
+#include "config.h"
+
+#define LOG_TAG "latency"
+
+#ifdef LATENCY_STATS
+
+bb_latency_histogram latency_histograms[ESC_MAX_CHANNELS];  // histogram for each servo channel
+uint8_t latency_pins[ESC_MAX_CHANNELS];                     // pin of each servo channel, for logging
+volatile bool latency_reset_pending = true;                 // set to ask the control task to clear the histograms
+
+void latency_record(uint8_t channel, uint8_t pin, uint32_t latency) {
+
+    // the histograms are only ever written by the control task, so they're cleared here
+    if (latency_reset_pending) {
+        memset(latency_histograms, 0, sizeof(latency_histograms));
+        latency_reset_pending = false;
+    }
+
+    bb_latency_histogram &h = latency_histograms[channel];
+    latency_pins[channel] = pin;
+
+    if (h.count == 0 || latency < h.min) h.min = latency;
+    if (latency > h.max) h.max = latency;
+    h.total += latency;
+    h.count++;
+
+    uint32_t bucket = latency / LATENCY_BUCKET_WIDTH;
+    if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+    h.buckets[bucket]++;
+
+}
+
+void latency_log() {
+
+    bool any = false;
+
+    for (uint8_t channel = 0; channel < ESC_MAX_CHANNELS; channel++) {
+
+        // take a copy, since the control task could update the histogram at any time
+        bb_latency_histogram h = latency_histograms[channel];
+        if (latency_reset_pending || h.count == 0) continue;
+        any = true;
+
+        // find the bucket containing the 99th percentile.  this reports the top of that
+        // bucket, so the p99 is rounded up to the next LATENCY_BUCKET_WIDTH
+        uint32_t target = h.count - (h.count / 100);
+        uint32_t seen = 0;
+        uint32_t p99 = h.max;
+        for (uint32_t bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++) {
+            seen += h.buckets[bucket];
+            if (seen >= target) {
+                p99 = min((bucket + 1) * LATENCY_BUCKET_WIDTH, h.max);
+                break;
+            }
+        }
+
+        logi(LOG_TAG, "pin %d: %lu changes | min %lu µs, mean %lu µs, p99 %lu µs, max %lu µs",
+            latency_pins[channel], (unsigned long) h.count, (unsigned long) h.min, (unsigned long) (h.total / h.count),
+            (unsigned long) p99, (unsigned long) h.max
+        );
+    }
+
+    if (!any) logi(LOG_TAG, "no latencies recorded yet");
+
+}
+
+void latency_reset() {
+    latency_reset_pending = true;
+    logi(LOG_TAG, "latency histograms cleared");
+}
+
+#endif
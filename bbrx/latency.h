@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include "config.h"
+
+/**
+ * @brief Histogram of the latency between controller reports and ESC pulse changes, for one servo channel
+ * 
+ * Bucket i counts latencies between i * LATENCY_BUCKET_WIDTH and (i + 1) * LATENCY_BUCKET_WIDTH µs.
+ * The last bucket also counts every latency beyond that.
+ */
+struct bb_latency_histogram {
+    uint32_t count;                         // number of latencies recorded
+    uint32_t min;                           // smallest latency (µs)
+    uint32_t max;                           // largest latency (µs)
+    uint64_t total;                         // sum of every latency, for working out the mean (µs)
+    uint32_t buckets[LATENCY_BUCKETS];
+};
+
+#ifdef LATENCY_STATS
+
+    /**
+     * @brief Record the time between a controller report being received and a servo channel's pulse changing in response
+     * 
+     * This is called by the control task.
+     * 
+     * @param channel the servo channel whose pulse changed
+     * @param pin the pin that the channel outputs on
+     * @param latency time between the report being received and the new pulse being written (µs)
+     */
+    void latency_record(uint8_t channel, uint8_t pin, uint32_t latency);
+
+    /**
+     * @brief Log the latency histogram of every servo channel (min, mean, p99 and max)
+     */
+    void latency_log();
+
+    /**
+     * @brief Clear the latency histograms
+     */
+    void latency_reset();
+
+#else
+
+    // when latency stats are disabled, these compile to nothing
+    inline void latency_record(uint8_t channel, uint8_t pin, uint32_t latency) {}
+    inline void latency_log() {}
+    inline void latency_reset() {}
+
+#endif
@@ -10,6 +10,7 @@
 
 // #define LOG_OUTPUT USBSerial
 #define LOG_OUTPUT Serial
+#define LOG_TX_BUFFER_SIZE 4096 // size of the serial transmit buffer, so that logging from the control loop doesn't have to wait for the uart
 
 #define NEWLINE "\n"
 #define ANSI_ENABLE // uncomment to disable ansi colour coding
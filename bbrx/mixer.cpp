@@ -0,0 +1,121 @@
+#include <cmath>
+#include "mixer.h"
+#include "scale.h"
+#include "log.h"
+
+#define LOG_TAG "mixer"
+
+uint8_t mixer_output_count = 0;                             // number of compiled mixer outputs
+uint8_t mixer_pins[MIXER_MAX_OUTPUTS];                      // pin of each output
+int32_t mixer_values[MIXER_MAX_OUTPUTS];                    // value of each output (fixed point)
+uint8_t mixer_controllers[MIXER_MAX_OUTPUTS];               // controller slots each output depends on
+
+uint8_t  mixer_input_count = 0;                             // number of compiled mixer inputs
+uint8_t  mixer_events[MIXER_MAX_INPUTS];                    // event of each input
+uint8_t  mixer_input_controllers[MIXER_MAX_INPUTS];         // controller slot of each input
+int32_t  mixer_range_lo[MIXER_MAX_INPUTS];                  // min(min, max) of each input, which beefzoned inputs are resolved to
+int32_t  mixer_range_hi[MIXER_MAX_INPUTS];                  // max(min, max) of each input
+bb_scale mixer_scales[MIXER_MAX_INPUTS];                    // transform from each input's range to -MIXER_ONE..MIXER_ONE
+
+int32_t  mixer_weights[MIXER_MAX_OUTPUTS][MIXER_MAX_INPUTS];   // weight of each input in each output (fixed point)
+int32_t  mixer_clamp[MIXER_MAX_OUTPUTS];                    // largest magnitude of each output (fixed point)
+int32_t  mixer_expo[MIXER_MAX_OUTPUTS];                     // expo of each output (fixed point)
+bool     mixer_reverse[MIXER_MAX_OUTPUTS];                  // whether each output is reversed
+
+// the weighted sum of every input (each clamped to -1..+1) must fit in 32 bits
+static_assert((int64_t) MIXER_MAX_INPUTS * MIXER_MAX_WEIGHT * MIXER_ONE * MIXER_ONE <= INT32_MAX, "mixer weights are too big for the mixer's fixed point");
+
+/**
+ * @brief Convert a number to the mixer's fixed point, limiting it to ±limit
+ */
+static int32_t mixer_fixed(float value, float limit) {
+    if (std::isnan(value)) return 0;
+    value = std::min(std::max(value, -limit), limit);
+    return lroundf(value * MIXER_ONE);
+}
+
+void mixer_compile() {
+
+    mixer_input_count = min(mixer_inputs.size(), (size_t) MIXER_MAX_INPUTS);
+    mixer_output_count = min(mixer_outputs.size(), (size_t) MIXER_MAX_OUTPUTS);
+    if (mixer_inputs.size() > MIXER_MAX_INPUTS)   logw(LOG_TAG, "The mixer can only have %d inputs; ignoring the rest", MIXER_MAX_INPUTS);
+    if (mixer_outputs.size() > MIXER_MAX_OUTPUTS) logw(LOG_TAG, "The mixer can only have %d outputs; ignoring the rest", MIXER_MAX_OUTPUTS);
+
+    // inputs with an unknown event are kept (so the weights of the inputs after them still line
+    // up), but they're given a weight of zero in every output
+    bool known[MIXER_MAX_INPUTS];
+    for (uint8_t i = 0; i < mixer_input_count; i++) {
+        const bb_mixer_input &in = mixer_inputs[i];
+        known[i] = (in.event < BB_EVENT_COUNT);
+        if (!known[i]) logw(LOG_TAG, "Unknown mixer input event (event=%d)", in.event);
+
+        mixer_events[i]   = known[i] ? in.event : 0;
+        mixer_input_controllers[i] = in.controller;
+        mixer_range_lo[i] = min(in.min, in.max);
+        mixer_range_hi[i] = max(in.min, in.max);
+        mixer_scales[i]   = scale_make(in.min, in.max, -MIXER_ONE, MIXER_ONE);
+    }
+
+    for (uint8_t o = 0; o < mixer_output_count; o++) {
+        const bb_mixer_output &out = mixer_outputs[o];
+        if (out.weights.size() > mixer_input_count) {
+            logw(LOG_TAG, "Mixer output on pin %d has more weights than there are inputs; ignoring the extra ones", out.pin);
+        }
+
+        mixer_pins[o]    = out.pin;
+        mixer_values[o]  = 0;
+        mixer_clamp[o]   = mixer_fixed(out.clamp, 1);
+        mixer_expo[o]    = mixer_fixed(out.expo, 1);
+        mixer_reverse[o] = out.reverse;
+        if (mixer_clamp[o] < 0) mixer_clamp[o] = 0;
+        if (mixer_expo[o] < 0)  mixer_expo[o] = 0;
+
+        // inputs without a weight get a weight of zero
+        mixer_controllers[o] = 0;
+        for (uint8_t i = 0; i < MIXER_MAX_INPUTS; i++) {
+            bool weighted = (i < mixer_input_count) && known[i] && (i < out.weights.size());
+            mixer_weights[o][i] = weighted ? mixer_fixed(out.weights[i], MIXER_MAX_WEIGHT) : 0;
+            if (mixer_weights[o][i]) mixer_controllers[o] |= 1 << mixer_input_controllers[i];
+        }
+    }
+
+    if (mixer_output_count) logi(LOG_TAG, "Compiled mixer with %d inputs and %d outputs", mixer_input_count, mixer_output_count);
+}
+
+void mixer_update(const bb_input_snapshot *const snapshots[BP32_MAX_GAMEPADS]) {
+
+    // scale every input to -1..+1
+    int32_t inputs[MIXER_MAX_INPUTS];
+    for (uint8_t i = 0; i < mixer_input_count; i++) {
+        const bb_input_snapshot *snapshot = snapshots[mixer_input_controllers[i]];
+        if (snapshot == nullptr) {
+            inputs[i] = 0;
+            continue;
+        }
+        int32_t value = snapshot->values[mixer_events[i]];
+        if      (value == BB_INPUT_BEEF_MAX) value = mixer_range_hi[i];
+        else if (value == BB_INPUT_BEEF_MIN) value = mixer_range_lo[i];
+        // inputs outside their range would scale past ±1 (and could overflow the sum below), so they're clamped
+        inputs[i] = min(max(scale_apply(mixer_scales[i], value), -MIXER_ONE), MIXER_ONE);
+    }
+
+    for (uint8_t o = 0; o < mixer_output_count; o++) {
+
+        // weighted sum of the inputs
+        const int32_t *weights = mixer_weights[o];
+        int32_t sum = 0;
+        for (uint8_t i = 0; i < mixer_input_count; i++) sum += weights[i] * inputs[i];
+        int32_t x = sum >> MIXER_SHIFT;
+        x = min(max(x, -MIXER_ONE), MIXER_ONE);
+
+        // expo: mix between x and x^3
+        if (mixer_expo[o]) {
+            int32_t cube = ((((x * x) >> MIXER_SHIFT) * x) >> MIXER_SHIFT);
+            x = ((MIXER_ONE - mixer_expo[o]) * x + mixer_expo[o] * cube) >> MIXER_SHIFT;
+        }
+
+        // clamp and reverse
+        x = min(max(x, -mixer_clamp[o]), mixer_clamp[o]);
+        mixer_values[o] = mixer_reverse[o] ? -x : x;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+ * mixer which combines several events into each of several servo outputs
+ *
+ * each output is a weighted sum of the inputs, like `left = LY + LX` and `right = LY - LX` for
+ * tank steering.  inputs are scaled from their range to -1..+1 first, and then after mixing, each
+ * output is clamped, softened around the centre (expo), and optionally reversed.  everything
+ * is done in fixed point, with MIXER_ONE = 1.
+ *
+ * each input can come from a different controller slot.  inputs from a slot with no controller
+ * count as 0 (the middle of their range).
+*/
+
+#include <cstdint>
+#include "controllers.h"
+#include "config.h"
+
+#define MIXER_SHIFT     12
+#define MIXER_ONE       (1 << MIXER_SHIFT)     // fixed-point value of 1 in the mixer
+
+/**
+ * @brief Number of mixer outputs, and the value and pin of each one
+ *
+ * mixer_values is only valid after mixer_update() has been called.  Values are between
+ * -MIXER_ONE and MIXER_ONE.
+ */
+extern uint8_t mixer_output_count;
+extern uint8_t mixer_pins[MIXER_MAX_OUTPUTS];
+extern int32_t mixer_values[MIXER_MAX_OUTPUTS];
+
+/**
+ * @brief Bitmask of the controller slots which each mixer output depends on
+ *
+ * A slot is included if any of its inputs have a non-zero weight in the output.
+ */
+extern uint8_t mixer_controllers[MIXER_MAX_OUTPUTS];
+
+/**
+ * @brief Compile the mixer settings from the config into the fixed-point form used each tick
+ *
+ * Should be called after the config has been loaded.
+ */
+void mixer_compile();
+
+/**
+ * @brief Work out the value of every mixer output from the input snapshots
+ *
+ * @param snapshots the input snapshot of each controller slot (nullptr if the slot has no controller)
+ */
+void mixer_update(const bb_input_snapshot *const snapshots[BP32_MAX_GAMEPADS]);
@@ -0,0 +1,37 @@
+#include "scale.h"
+
+bb_scale scale_make(int32_t in_min, int32_t in_max, int32_t out_min, int32_t out_max) {
+
+    bb_scale s;
+    s.in_min = in_min;
+    s.in_max = in_max;
+    s.out_min = out_min;
+    s.out_max = out_max;
+    s.multiplier = 0;
+    s.shift = SCALE_USE_MAP;
+    s.negative = false;
+
+    int64_t run = (int64_t) in_max - in_min;
+    int64_t rise = (int64_t) out_max - out_min;
+    if (run == 0) return s;     // map() handles this case
+
+    uint64_t run_magnitude = (run < 0) ? -run : run;
+    uint64_t rise_magnitude = (rise < 0) ? -rise : rise;
+
+    // for the fixed-point result to always round the same way as the divide, the error in the
+    // multiplier (which is rounded up) multiplied by the largest input must be less than
+    // 1 / run.  this is the case if there are at least SCALE_INPUT_BITS + log2(run) fractional bits
+    uint8_t shift = SCALE_INPUT_BITS;
+    while ((1ULL << (shift - SCALE_INPUT_BITS)) < run_magnitude) shift++;
+    if (shift > 62) return s;
+
+    // multiplier = ceil(rise * 2^shift / run)
+    if (rise_magnitude > (UINT64_MAX >> shift)) return s;
+    uint64_t multiplier = ((rise_magnitude << shift) + run_magnitude - 1) / run_magnitude;
+    if (multiplier > UINT32_MAX) return s;
+
+    s.multiplier = multiplier;
+    s.shift = shift;
+    s.negative = (rise < 0) != (run < 0);
+    return s;
+}
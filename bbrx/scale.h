@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Arduino.h>
+#include <cstdint>
+
+#define SCALE_INPUT_BITS    20      // the fixed-point path is used for inputs within ±2^SCALE_INPUT_BITS of the input minimum
+#define SCALE_USE_MAP       0xFF    // shift value which means the fixed-point path can't be used, so map() is always used
+
+/**
+ * @brief A precomputed linear transform from an input range to an output range
+ * 
+ * This gives exactly the same result as arduino-esp32's map(), which is
+ * `(x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min` (rounded towards zero),
+ * but without the divide.  The ratio of the output range to the input range is stored as a
+ * fixed-point multiplier, which is chosen so that multiplying by it and shifting right rounds
+ * to exactly the same value as the divide would, for any input within ±2^SCALE_INPUT_BITS
+ * of in_min.  Inputs further away than that (or ranges whose multiplier won't fit in 32 bits)
+ * just use map().
+ */
+struct bb_scale {
+    int32_t  in_min;        // input range and output range, as they'd be passed to map()
+    int32_t  in_max;
+    int32_t  out_min;
+    int32_t  out_max;
+    uint32_t multiplier;    // |output range / input range|, with `shift` fractional bits
+    uint8_t  shift;         // number of fractional bits in multiplier, or SCALE_USE_MAP
+    bool     negative;      // whether output range / input range is negative
+};
+
+/**
+ * @brief Precompute the transform from one range to another
+ * 
+ * @param in_min value of the input that maps to out_min
+ * @param in_max value of the input that maps to out_max
+ * @param out_min 
+ * @param out_max 
+ * @return bb_scale the transform, for use with scale_apply()
+ */
+bb_scale scale_make(int32_t in_min, int32_t in_max, int32_t out_min, int32_t out_max);
+
+/**
+ * @brief Transform a value using a precomputed scale (the equivalent of map())
+ * 
+ * @param s the transform, from scale_make()
+ * @param x the value to transform
+ * @return int32_t the transformed value
+ */
+inline int32_t scale_apply(const bb_scale &s, int32_t x) {
+
+    int64_t delta = (int64_t) x - s.in_min;
+    uint32_t magnitude = (delta < 0) ? -delta : delta;
+
+    if (s.shift == SCALE_USE_MAP || delta <= -(1 << SCALE_INPUT_BITS) || delta >= (1 << SCALE_INPUT_BITS)) {
+        return map(x, s.in_min, s.in_max, s.out_min, s.out_max);
+    }
+
+    int32_t out = ((uint64_t) magnitude * s.multiplier) >> s.shift;
+    return (((delta < 0) != s.negative) ? -out : out) + s.out_min;
+}
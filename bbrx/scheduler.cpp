@@ -0,0 +1,181 @@
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include "scheduler.h"
+#include "event_manager.h"
+#include "controllers.h"
+#include "alloc_check.h"
+#include "log.h"
+#include "config.h"
+
+#define LOG_TAG "scheduler"
+
+TaskHandle_t control_task = nullptr;            // task which runs the event manager
+esp_timer_handle_t control_timer = nullptr;     // hardware timer which triggers each control tick
+uint32_t control_period = 0;                    // time between control ticks (µs)
+std::atomic<bool> control_asleep{false};        // whether the control task is asleep, waiting for new input (see scheduler_wake())
+
+bb_scheduler_stats scheduler_stats;             // timing stats since they were last logged
+volatile bool scheduler_stats_reset = false;    // set to ask the control task to reset the stats
+unsigned long scheduler_stats_last_log = 0;     // time at which the stats were last logged (ms)
+
+/**
+ * @brief Timer callback which triggers a control tick
+ * 
+ * This runs in the esp_timer task, so all it does is wake up the control task.
+ */
+void control_timer_callback(void *arg) {
+    xTaskNotifyGive(control_task);
+}
+
+/**
+ * @brief Task which runs the event manager once per control tick
+ */
+void control_task_main(void *arg) {
+
+    int64_t last_start = 0;
+    bool woken = false;
+
+    for (;;) {
+
+        // wait for the next tick (unless the task has just woken up, in which case the tick
+        // runs straight away).  if more than one notification has built up, the previous tick
+        // ran for so long that the ticks in between were missed
+        uint32_t pending = woken ? 1 : ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t start = esp_timer_get_time();
+        woken = false;
+
+        // run the control loop (which mustn't allocate, see alloc_check.h)
+        alloc_check_begin();
+        event_manager_update();
+        alloc_check_end();
+
+        int64_t end = esp_timer_get_time();
+
+        // update stats
+        if (scheduler_stats_reset) {
+            scheduler_stats = {};
+            scheduler_stats_reset = false;
+        }
+
+        uint32_t exec = end - start;
+        scheduler_stats.ticks++;
+        scheduler_stats.missed += pending - 1;
+        scheduler_stats.exec_total += exec;
+        if (exec > scheduler_stats.exec_max) scheduler_stats.exec_max = exec;
+        if (exec > control_period) scheduler_stats.overruns++;
+
+        if (last_start != 0) {
+            int64_t interval = start - last_start;
+            uint32_t jitter = (interval > control_period) ? interval - control_period : control_period - interval;
+            scheduler_stats.jitter_total += jitter;
+            if (jitter > scheduler_stats.jitter_max) scheduler_stats.jitter_max = jitter;
+        }
+        last_start = start;
+
+        // if the event manager has nothing to do until there's new input, stop the ticks and
+        // sleep until the input task wakes the control task up (or the event manager's timeout)
+        if (!CONTROL_SLEEP_WHEN_IDLE) continue;
+        uint32_t sleep = event_manager_sleep_time();
+        if (sleep == 0) continue;
+
+        esp_timer_stop(control_timer);
+        control_asleep = true;
+
+        // input published after the tick read the controllers but before control_asleep was set
+        // didn't wake the task, so check for it before going to sleep.  if there is some, skip
+        // the sleep (and throw away any notification scheduler_wake() or the timer already gave)
+        bool slept = !controller_pending();
+        ulTaskNotifyTake(pdTRUE, !slept ? 0 : (sleep == EVENT_SLEEP_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(sleep));
+        control_asleep = false;
+        esp_timer_start_periodic(control_timer, control_period);
+
+        // the ticks start again from now, so the time asleep doesn't count as jitter
+        if (slept) {
+            scheduler_stats.sleeps++;
+            scheduler_stats.asleep_total += esp_timer_get_time() - end;
+        }
+        last_start = 0;
+        woken = true;
+    }
+
+}
+
+/**
+ * @brief Start running the event manager at a fixed rate
+ * 
+ * This starts a high priority task which runs event_manager_update(), and a hardware timer which
+ * triggers it CONTROL_RATE times a second.  If CONTROL_SLEEP_WHEN_IDLE is set, the timer is
+ * stopped while the event manager has nothing to do, and the input task wakes the control task
+ * up again when there's new input (see scheduler_wake()).  Should be called once, after
+ * everything the event manager needs has been set up.
+ */
+void scheduler_setup() {
+
+    // keep the rate within a sensible range
+    if (CONTROL_RATE < CONTROL_RATE_MIN) CONTROL_RATE = CONTROL_RATE_MIN;
+    if (CONTROL_RATE > CONTROL_RATE_MAX) CONTROL_RATE = CONTROL_RATE_MAX;
+    control_period = 1000000UL / CONTROL_RATE;
+
+    logi(LOG_TAG, "Starting control loop at %d Hz (period %d µs)", CONTROL_RATE, control_period);
+
+    // start control task
+    xTaskCreatePinnedToCore(control_task_main, "bbrx control", CONTROL_TASK_STACK, nullptr, CONTROL_TASK_PRIORITY, &control_task, CONTROL_TASK_CORE);
+
+    // start timer
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = control_timer_callback;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "bbrx control";
+    esp_timer_create(&timer_args, &control_timer);
+    esp_timer_start_periodic(control_timer, control_period);
+
+    scheduler_stats_last_log = millis();
+}
+
+/**
+ * @brief Wake the control task up if it's asleep, so it runs a tick straight away
+ * 
+ * Should be called by the input task whenever it publishes new input.  This does nothing while
+ * the control task is ticking, so new input never makes ticks happen faster than CONTROL_RATE.
+ */
+void scheduler_wake() {
+    if (control_task != nullptr && control_asleep.exchange(false)) xTaskNotifyGive(control_task);
+}
+
+/**
+ * @brief Log the control loop's timing stats, if it's time to
+ * 
+ * This should be called from the main loop (ie: not the control task), so logging doesn't eat
+ * into the time available for each control tick.
+ */
+void scheduler_log_stats() {
+
+    #ifdef SCHEDULER_STATS
+
+        if (millis() - scheduler_stats_last_log < SCHEDULER_STATS_PERIOD) return;
+        scheduler_stats_last_log = millis();
+
+        // take a copy, since the control task could update the stats at any time
+        // (if the reset from the last log is still pending, the control task hasn't ticked since then)
+        bool stale = scheduler_stats_reset;
+        bb_scheduler_stats stats = scheduler_stats;
+        scheduler_stats_reset = true;
+        if (stale || stats.ticks == 0) {
+            if (CONTROL_SLEEP_WHEN_IDLE) logi(LOG_TAG, "no control ticks in the last %d ms (asleep)", SCHEDULER_STATS_PERIOD);
+            else                         logw(LOG_TAG, "no control ticks in the last %d ms!", SCHEDULER_STATS_PERIOD);
+            return;
+        }
+
+        logi(LOG_TAG, "%lu ticks, %lu missed, %lu overruns | exec mean %lu µs max %lu µs | jitter mean %lu µs max %lu µs | slept %lu times for %lu ms",
+            (unsigned long) stats.ticks, (unsigned long) stats.missed, (unsigned long) stats.overruns,
+            (unsigned long) (stats.exec_total / stats.ticks), (unsigned long) stats.exec_max,
+            (unsigned long) (stats.jitter_total / stats.ticks), (unsigned long) stats.jitter_max,
+            (unsigned long) stats.sleeps, (unsigned long) (stats.asleep_total / 1000)
+        );
+
+    #endif
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Timing statistics for the control loop
+ * 
+ * These are accumulated by the control task, and reset each time they're logged.
+ */
+struct bb_scheduler_stats {
+    uint32_t ticks;             // number of control ticks run
+    uint32_t missed;            // number of ticks which were skipped because the previous tick was still running
+    uint32_t overruns;          // number of ticks which took longer than one period to run
+    uint32_t jitter_max;        // largest difference between the time between two ticks and the tick period (µs)
+    uint64_t jitter_total;      // sum of the jitter of every tick, for working out the mean (µs)
+    uint32_t exec_max;          // longest time taken to run a tick (µs)
+    uint64_t exec_total;        // sum of the time taken to run every tick, for working out the mean (µs)
+    uint32_t sleeps;            // number of times the control loop went to sleep because it had nothing to do
+    uint64_t asleep_total;      // total time the control loop spent asleep (µs)
+};
+
+void scheduler_setup();
+void scheduler_wake();
+void scheduler_log_stats();
@@ -1,9 +1,11 @@
 #include <map>
 #include <math.h>
 #include <Arduino.h>
+#include "config.h"             // before FastLED.h, since it sets FastLED's RMT options
 #include <FastLED.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include "log.h"
-#include "config.h"
 #include "status_led.h"
 
 #define LOG_TAG "status"
@@ -20,6 +22,13 @@ uint8_t pulse_brightness = current_brightness;
 int8_t pulse_step = -1;
 uint8_t pulse_divider = 1;
 
+/**
+ * Queue of state changes requested by leds_request_state(), to be applied by leds_update().  Each
+ * item is a LED_STATE, or LED_REQUEST_PREVIOUS to go back to the previous state.
+ */
+QueueHandle_t led_requests = nullptr;
+#define LED_REQUEST_PREVIOUS -1
+
 /**
  * A map of each system state to an object which describes what to do with the status led.
  * This object is an std::pair, where the first element is the colour to show, and the second 
@@ -60,6 +69,9 @@ void leds_setup() {
             leds[0] = CRGB::White;
             FastLED.show();
 
+            // create queue for state change requests
+            led_requests = xQueueCreate(STATUS_LED_QUEUE_LENGTH, sizeof(int8_t));
+
         #else
 
             logi(LOG_TAG, "Status LED is disabled");
@@ -153,6 +165,32 @@ void leds_set_state_previous() {
     #endif
 }
 
+/**
+ * @brief Ask for the LED to change state, the next time leds_update() is run
+ * 
+ * This is the same as `leds_set_state()`, except that the LED isn't actually updated straight away.
+ * This is safe to call from any task, so it should be used instead of `leds_set_state()` by the
+ * control loop, so that updating the LED doesn't take up any of its time.
+ * 
+ * @param new_state the state of which to show the relevant LED colour and animation
+ */
+void leds_request_state(LED_STATE new_state) {
+    #ifdef STATUS_LED_ENABLE
+        int8_t request = new_state;
+        if (led_requests != nullptr) xQueueSend(led_requests, &request, 0);
+    #endif
+}
+
+/**
+ * @brief Similar to `leds_request_state()`, but switches to whatever the previous state was.
+ */
+void leds_request_state_previous() {
+    #ifdef STATUS_LED_ENABLE
+        int8_t request = LED_REQUEST_PREVIOUS;
+        if (led_requests != nullptr) xQueueSend(led_requests, &request, 0);
+    #endif
+}
+
 uint64_t eee = 0;
 
 /**
@@ -162,6 +200,13 @@ void leds_update() {
 
     #ifdef STATUS_LED_ENABLE
 
+        // apply any requested state changes, in the order they were requested
+        int8_t request;
+        while (led_requests != nullptr && xQueueReceive(led_requests, &request, 0) == pdTRUE) {
+            if (request == LED_REQUEST_PREVIOUS) leds_set_state_previous();
+            else                                 leds_set_state((LED_STATE) request);
+        }
+
         // if pulsing is enabled for the current state
         if (current_pulse_delay != -1) {
 
@@ -14,4 +14,6 @@ enum LED_STATE {
 void leds_setup();
 void leds_set_state(LED_STATE new_state);
 void leds_set_state_previous();
+void leds_request_state(LED_STATE new_state);
+void leds_request_state_previous();
 void leds_update();
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Hashed timer wheel, for timers which expire on a particular tick
+ *
+ * Each timer is identified by an index (0 to size-1), and can be scheduled to expire on any
+ * tick.  Timers are kept in a ring of SLOTS doubly-linked lists, where the list for each slot
+ * holds every timer whose deadline is that slot's tick (plus any multiple of SLOTS).  advance()
+ * should be called once for every tick, in order; it only looks at the list for that tick's
+ * slot, so the cost of each tick depends on how many timers are in that slot rather than how
+ * many there are in total.  Timers whose deadline is more than SLOTS ticks away just get
+ * skipped over until the wheel comes round to their tick.
+ *
+ * Scheduling and cancelling are O(1), and nothing is allocated except in resize().
+ */
+template<uint16_t SLOTS>
+class timer_wheel {
+public:
+    static_assert((SLOTS & (SLOTS - 1)) == 0, "the number of timer wheel slots must be a power of two");
+
+    static constexpr uint16_t NONE = 0xFFFF;        // end of a list
+
+    timer_wheel() { clear(); }
+
+    /**
+     * @brief Set the number of timers, and cancel all of them
+     *
+     * @param size how many timers there are (less than NONE)
+     */
+    void resize(uint16_t size) {
+        next.assign(size, NONE);
+        prev.assign(size, NONE);
+        deadlines.assign(size, 0);
+        clear();
+    }
+
+    /**
+     * @brief Cancel every timer
+     */
+    void clear() {
+        for (uint16_t &head : heads) head = NONE;
+        for (uint16_t &p : prev) p = NONE;
+        for (uint16_t &n : next) n = NONE;
+        linked.assign(next.size(), false);
+        active = 0;
+    }
+
+    /**
+     * @brief Schedule a timer to expire on a tick, replacing its previous deadline if it had one
+     *
+     * @param timer which timer to schedule
+     * @param deadline the tick on which it should expire (it must be after the current tick)
+     */
+    void schedule(uint16_t timer, uint32_t deadline) {
+        cancel(timer);
+        deadlines[timer] = deadline;
+
+        uint16_t &head = heads[deadline & (SLOTS - 1)];
+        next[timer] = head;
+        prev[timer] = NONE;
+        if (head != NONE) prev[head] = timer;
+        head = timer;
+        linked[timer] = true;
+        active++;
+    }
+
+    /**
+     * @brief Stop a timer from expiring (does nothing if it isn't scheduled)
+     */
+    void cancel(uint16_t timer) {
+        if (!linked[timer]) return;
+
+        if (prev[timer] != NONE) next[prev[timer]] = next[timer];
+        else                     heads[deadlines[timer] & (SLOTS - 1)] = next[timer];
+        if (next[timer] != NONE) prev[next[timer]] = prev[timer];
+        linked[timer] = false;
+        active--;
+    }
+
+    /**
+     * @brief Whether a timer is scheduled
+     */
+    bool scheduled(uint16_t timer) const { return linked[timer]; }
+
+    /**
+     * @brief Whether any timer is scheduled
+     */
+    bool any_scheduled() const { return active != 0; }
+
+    /**
+     * @brief Expire every timer whose deadline is a tick
+     *
+     * Each expired timer is cancelled before expired is called, so expired can schedule it
+     * again.
+     *
+     * @param tick the current tick
+     * @param expired function (or lambda) which is called with the index of each expired timer
+     */
+    template<typename F>
+    void advance(uint32_t tick, F &&expired) {
+        uint16_t timer = heads[tick & (SLOTS - 1)];
+        while (timer != NONE) {
+            uint16_t following = next[timer];
+            if (deadlines[timer] == tick) {
+                cancel(timer);
+                expired(timer);
+            }
+            timer = following;
+        }
+    }
+
+private:
+    uint16_t heads[SLOTS];                          // first timer in each slot's list
+    std::vector<uint16_t> next;                     // next timer in the same slot as each timer
+    std::vector<uint16_t> prev;                     // previous timer in the same slot as each timer
+    std::vector<uint32_t> deadlines;                // tick on which each timer expires
+    std::vector<bool> linked;                       // whether each timer is scheduled
+    uint16_t active = 0;                            // number of timers which are scheduled
+};
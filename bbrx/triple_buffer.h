@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Lock-free single-producer single-consumer triple buffer
+ * 
+ * This hands the latest value of something from one task to another, without either task ever
+ * having to wait for the other.  There are three copies of the value: one being written by the
+ * producer (the back buffer), one being read by the consumer (the front buffer), and the most
+ * recently published one (the middle buffer).  Publishing and reading just swap buffer indexes
+ * with the middle buffer, so only the newest value is ever read, and older values which were
+ * never read are overwritten.
+ * 
+ * The producer should write to back() and then call publish().  The consumer should call
+ * update() and then read from front().
+ */
+template<typename T>
+class triple_buffer {
+public:
+
+    /**
+     * @brief (producer) The buffer to write the next value into
+     */
+    T &back() { return buffers[back_index]; }
+
+    /**
+     * @brief (producer) Publish the value in the back buffer, making it available to the consumer
+     * 
+     * @return true if the previously published value was never read by the consumer (ie: it was dropped)
+     */
+    bool publish() {
+        uint32_t previous = middle.exchange(back_index | FRESH, std::memory_order_acq_rel);
+        back_index = previous & INDEX_MASK;
+        return previous & FRESH;
+    }
+
+    /**
+     * @brief (consumer) Swap in the most recently published value, if there is a new one
+     * 
+     * @return true if there was a new value
+     * @return false if nothing has been published since the last update, so front() hasn't changed
+     */
+    bool update() {
+        if (!(middle.load(std::memory_order_acquire) & FRESH)) return false;
+        uint32_t previous = middle.exchange(front_index, std::memory_order_acq_rel);
+        front_index = previous & INDEX_MASK;
+        return true;
+    }
+
+    /**
+     * @brief (consumer) Check whether a new value has been published since the last update, without swapping it in
+     */
+    bool fresh() const { return middle.load(std::memory_order_seq_cst) & FRESH; }
+
+    /**
+     * @brief (consumer) The most recent value that was swapped in by update()
+     */
+    const T &front() const { return buffers[front_index]; }
+
+private:
+    static constexpr uint32_t INDEX_MASK = 0x3;     // bits of middle which are the index of the middle buffer
+    static constexpr uint32_t FRESH      = 0x4;     // bit of middle which is set if the middle buffer hasn't been read yet
+
+    T buffers[3] = {};
+    uint32_t back_index = 0;                        // only used by the producer
+    uint32_t front_index = 1;                       // only used by the consumer
+    std::atomic<uint32_t> middle{2};                // shared
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+/*
+ * simulator-side interface shared between the stand-in libraries (stubs/) and
+ * the simulator driver (sim_main.cpp)
+*/
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <Bluepad32.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// kind of hardware write captured by the output recorder
+enum sim_output_kind {
+    SIM_OUT_PWM,        // servo pulse width in µs
+    SIM_OUT_GPIO,       // digital level
+    SIM_OUT_DSHOT,      // DShot value (throttle or command), or -1 if the frame's checksum was wrong
+};
+
+// a single captured hardware write
+struct sim_output_record {
+    uint64_t        time_us;
+    sim_output_kind kind;
+    uint8_t         pin;
+    int32_t         value;
+};
+
+// a duty cycle update made by the LEDC model (see sim_ledc.cpp)
+struct sim_pulse_record {
+    uint64_t        write_us;       // time the duty cycle was updated
+    double          start_us;       // time the first pulse with the new duty cycle started
+    uint8_t         pin;
+    uint32_t        width_ns;       // width of each pulse
+    uint32_t        period_ns;      // time from the start of one pulse to the start of the next
+};
+
+// DShot frames decoded by the RMT model (see sim_rmt.cpp), for one pin
+struct sim_dshot_record {
+    uint32_t        frames;         // number of frames sent
+    uint32_t        bad_frames;     // number of frames which couldn't be decoded, or had the wrong checksum
+    uint32_t        bitrate;        // bitrate of the last frame (bit/s)
+    int32_t         value;          // value of the last good frame
+};
+
+// feedback sent to a virtual gamepad
+struct sim_feedback_record {
+    uint32_t        commands;       // number of feedback commands sent
+    int32_t         rumble;         // strength of the last rumble (-1 = never sent)
+    int32_t         colour;         // last lightbar colour (0xRRGGBB, -1 = never sent)
+    int32_t         leds;           // last player LEDs bitmask (-1 = never sent)
+};
+
+// the hardware models keep their logs on the heap, where the real hardware wouldn't allocate
+// anything, so they're left out of the control loop's allocation check (see alloc_check.h) by
+// putting one of these at the top of each model entry point the control loop calls
+#ifdef ALLOC_CHECK
+    extern TaskHandle_t alloc_check_task;
+    struct sim_alloc_exempt {
+        TaskHandle_t task = alloc_check_task;
+        sim_alloc_exempt()  { alloc_check_task = nullptr; }
+        ~sim_alloc_exempt() { alloc_check_task = task; }
+    };
+#else
+    struct sim_alloc_exempt { sim_alloc_exempt() {} };
+#endif
+
+// simulator clock.  normally this follows the host's clock, but it can be switched to a
+// virtual clock which only moves when it's told to
+void sim_clock_virtual(bool enable);
+void sim_clock_advance(uint64_t us);
+
+// gpio / pwm recorder.  only read the log once recording has been stopped
+extern std::atomic<bool> sim_recording;
+void sim_record_output(sim_output_kind kind, uint8_t pin, int32_t value);
+bool sim_last_output(sim_output_kind kind, uint8_t pin, int32_t &value);
+const std::vector<sim_output_record> &sim_output_log();
+
+// LEDC pulse recorder.  only read the log once recording has been stopped
+bool sim_last_pulse(uint8_t pin, sim_pulse_record &record);
+const std::vector<sim_pulse_record> &sim_pulse_log();
+
+// DShot frame counters
+bool sim_dshot_info(uint8_t pin, sim_dshot_record &record);
+
+// virtual gamepads
+extern Controller sim_gamepads[BP32_MAX_GAMEPADS];
+void sim_gamepad_connect(int idx);
+void sim_gamepad_disconnect(int idx);
+void sim_gamepad_report(int idx, const sim_gamepad_state &state);
+bool sim_feedback_info(int idx, sim_feedback_record &record);
+
+// filesystem root used by the LittleFS stand-in, and individual files which override it
+void sim_set_fs_root(const std::string &dir);
+void sim_map_file(const std::string &path, const std::string &host_path);
+
+// esc model (see sim_esc.cpp)
+void  sim_esc_pulse(uint8_t pin, int32_t pulse_us, uint64_t time_us);
+void  sim_esc_dshot(uint8_t pin, int32_t value, uint64_t time_us);
+bool  sim_esc_exists(uint8_t pin);
+bool  sim_esc_armed(uint8_t pin, uint64_t time_us);
+float sim_esc_speed(uint8_t pin, uint64_t time_us);
@@ -0,0 +1,97 @@
+/*
+ * a simple model of a bidirectional brushed/brushless car ESC, driven by the servo
+ * pulses that bbrx writes (or a unidirectional one, driven by DShot frames)
+ *
+ * - the ESC won't drive the motor until it has seen a neutral pulse for SIM_ESC_ARM_TIME
+ *   (like most real ESCs, which refuse to arm if the throttle isn't centred at power-on)
+ * - pulses within SIM_ESC_DEADBAND of ESC_PWM_MID are treated as neutral
+ * - outside of that, the commanded speed scales linearly up to ±100% at ESC_PWM_MIN / ESC_PWM_MAX
+ * - for DShot, zero throttle (and the special commands, 1-47) is neutral, and throttle values
+ *   scale linearly from 0% at 48 up to 100% at 2047
+ * - the motor doesn't respond instantly; its speed follows the command with a first-order lag
+ *
+ * the motor speed is worked out lazily from the time of the last pulse, so the model doesn't
+ * need to be stepped.
+*/
+
+#include <cmath>
+#include <map>
+#include <mutex>
+#include "config.h"
+#include "sim.h"
+
+#define SIM_ESC_ARM_TIME    500000      // how long the pulse must be neutral before the esc arms (µs)
+#define SIM_ESC_DEADBAND    25          // pulses this close to ESC_PWM_MID are neutral (µs)
+#define SIM_ESC_TAU         80000.0f    // time constant of the motor's response (µs)
+
+struct sim_esc {
+    bool     armed = false;
+    uint64_t neutral_since = 0;         // time at which the pulse last became neutral (0 = not neutral)
+    float    command = 0;               // commanded speed since last_time (-1 to 1)
+    float    speed = 0;                 // motor speed at last_time (-1 to 1)
+    uint64_t last_time = 0;             // time of the last pulse (µs)
+};
+
+static std::map<uint8_t, sim_esc> escs;
+static std::mutex esc_lock;
+
+// motor speed at a time, given the state at the last pulse
+static float esc_speed_at(const sim_esc &esc, uint64_t time_us) {
+    if (time_us <= esc.last_time) return esc.speed;
+    float decay = expf(-(float) (time_us - esc.last_time) / SIM_ESC_TAU);
+    return esc.command + (esc.speed - esc.command) * decay;
+}
+
+// give an esc a new commanded speed (-1 to 1, 0 = neutral)
+static void esc_command(uint8_t pin, float command, uint64_t time_us) {
+    std::lock_guard<std::mutex> guard(esc_lock);
+    sim_esc &esc = escs[pin];
+
+    // integrate the motor up to now
+    esc.speed = esc_speed_at(esc, time_us);
+    esc.last_time = time_us;
+
+    // arming (the pulse may have been neutral for long enough since the last write)
+    if (esc.neutral_since != 0 && time_us - esc.neutral_since >= SIM_ESC_ARM_TIME) esc.armed = true;
+    if (command == 0) {
+        if (esc.neutral_since == 0) esc.neutral_since = time_us ? time_us : 1;
+    }
+    else esc.neutral_since = 0;
+
+    esc.command = esc.armed ? command : 0;
+}
+
+void sim_esc_pulse(uint8_t pin, int32_t pulse_us, uint64_t time_us) {
+    int32_t offset = pulse_us - ESC_PWM_MID;
+    float command = 0;
+    if      (offset >  SIM_ESC_DEADBAND) command = (float) (offset - SIM_ESC_DEADBAND) / (ESC_PWM_MAX - ESC_PWM_MID - SIM_ESC_DEADBAND);
+    else if (offset < -SIM_ESC_DEADBAND) command = (float) (offset + SIM_ESC_DEADBAND) / (ESC_PWM_MID - ESC_PWM_MIN - SIM_ESC_DEADBAND);
+    esc_command(pin, std::min(std::max(command, -1.0f), 1.0f), time_us);
+}
+
+void sim_esc_dshot(uint8_t pin, int32_t value, uint64_t time_us) {
+    float command = (value >= 48) ? (float) (value - 47) / 2000 : 0;
+    esc_command(pin, std::min(command, 1.0f), time_us);
+}
+
+bool sim_esc_exists(uint8_t pin) {
+    std::lock_guard<std::mutex> guard(esc_lock);
+    return escs.count(pin) != 0;
+}
+
+bool sim_esc_armed(uint8_t pin, uint64_t time_us) {
+    std::lock_guard<std::mutex> guard(esc_lock);
+    auto it = escs.find(pin);
+    if (it == escs.end()) return false;
+
+    // the esc also arms if the pulse has simply stayed neutral since the last write
+    const sim_esc &esc = it->second;
+    return esc.armed || (esc.neutral_since != 0 && time_us - esc.neutral_since >= SIM_ESC_ARM_TIME);
+}
+
+float sim_esc_speed(uint8_t pin, uint64_t time_us) {
+    std::lock_guard<std::mutex> guard(esc_lock);
+    auto it = escs.find(pin);
+    if (it == escs.end()) return 0;
+    return esc_speed_at(it->second, time_us);
+}
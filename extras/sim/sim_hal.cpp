@@ -0,0 +1,251 @@
+/*
+ * host implementations of the stand-in libraries in stubs/
+*/
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <map>
+#include <Arduino.h>
+#include <FastLED.h>
+#include <LittleFS.h>
+#include <Bluepad32.h>
+#include "sim.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+CFastLED FastLED;
+fs::LittleFSFS LittleFS;
+Bluepad32 BP32;
+Controller sim_gamepads[BP32_MAX_GAMEPADS];
+
+static const auto sim_epoch = std::chrono::steady_clock::now();
+static std::vector<sim_output_record> output_log;
+static std::mutex output_lock;
+
+//-------------------------------------------
+// clock
+//-------------------------------------------
+
+// when the clock is virtual, it starts from 0 and only moves when sim_clock_advance() is called
+static std::atomic<bool> clock_virtual{false};
+static std::atomic<uint64_t> clock_virtual_us{0};
+
+void sim_clock_virtual(bool enable) {
+    clock_virtual_us = 0;
+    clock_virtual = enable;
+}
+
+void sim_clock_advance(uint64_t us) {
+    clock_virtual_us += us;
+}
+
+unsigned long micros() {
+    if (clock_virtual) return clock_virtual_us;
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sim_epoch).count();
+}
+
+uint32_t EspClass::getCycleCount() {
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sim_epoch).count();
+    return (uint32_t) (ns * getCpuFreqMHz() / 1000);
+}
+
+unsigned long millis() {
+    return micros() / 1000;
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+//-------------------------------------------
+// outputs
+//-------------------------------------------
+
+std::atomic<bool> sim_recording{true};
+
+void sim_record_output(sim_output_kind kind, uint8_t pin, int32_t value) {
+    sim_alloc_exempt exempt;
+    std::lock_guard<std::mutex> guard(output_lock);
+    if (!sim_recording) return;
+    output_log.push_back({(uint64_t) micros(), kind, pin, value});
+}
+
+bool sim_last_output(sim_output_kind kind, uint8_t pin, int32_t &value) {
+    std::lock_guard<std::mutex> guard(output_lock);
+    for (auto it = output_log.rbegin(); it != output_log.rend(); it++) {
+        if (it->kind == kind && it->pin == pin) {
+            value = it->value;
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::vector<sim_output_record> &sim_output_log() {
+    return output_log;
+}
+
+static uint8_t gpio_levels[256];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void) pin; (void) mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    gpio_levels[pin] = val;
+    sim_record_output(SIM_OUT_GPIO, pin, val);
+}
+
+int digitalRead(uint8_t pin) {
+    return gpio_levels[pin];
+}
+
+//-------------------------------------------
+// filesystem
+//-------------------------------------------
+
+static std::string fs_root = ".";
+static std::map<std::string, std::string> fs_files;
+
+void sim_set_fs_root(const std::string &dir) {
+    fs_root = dir;
+}
+
+void sim_map_file(const std::string &path, const std::string &host_path) {
+    fs_files[path] = host_path;
+}
+
+fs::File fs::FS::open(const char *path, const char *mode) {
+    auto mapped = fs_files.find(path);
+    std::string full = (mapped != fs_files.end()) ? mapped->second : fs_root + path;
+    return fs::File(fopen(full.c_str(), mode), path);
+}
+
+size_t fs::File::size() const {
+    if (!f) return 0;
+    long pos = ftell(f.get());
+    fseek(f.get(), 0, SEEK_END);
+    long end = ftell(f.get());
+    fseek(f.get(), pos, SEEK_SET);
+    return end;
+}
+
+int fs::File::available() {
+    if (!f) return 0;
+    int c = fgetc(f.get());
+    if (c == EOF) return 0;
+    ungetc(c, f.get());
+    return 1;
+}
+
+int fs::File::read() {
+    return f ? fgetc(f.get()) : -1;
+}
+
+//-------------------------------------------
+// bluepad32
+//-------------------------------------------
+
+static GamepadCallback on_connected = nullptr;
+static GamepadCallback on_disconnected = nullptr;
+
+// pending script updates, applied on the next BP32.update() (like real reports)
+static std::recursive_mutex gamepad_lock;
+static bool pending_connect[BP32_MAX_GAMEPADS];
+static bool pending_disconnect[BP32_MAX_GAMEPADS];
+static bool pending_report[BP32_MAX_GAMEPADS];
+static sim_gamepad_state pending_state[BP32_MAX_GAMEPADS];
+
+void sim_gamepad_connect(int idx) {
+    std::lock_guard<std::recursive_mutex> guard(gamepad_lock);
+    pending_connect[idx] = true;
+}
+
+void sim_gamepad_disconnect(int idx) {
+    std::lock_guard<std::recursive_mutex> guard(gamepad_lock);
+    pending_disconnect[idx] = true;
+}
+
+void sim_gamepad_report(int idx, const sim_gamepad_state &state) {
+    std::lock_guard<std::recursive_mutex> guard(gamepad_lock);
+    pending_state[idx] = state;
+    pending_report[idx] = true;
+}
+
+void Bluepad32::setup(const GamepadCallback &on_connect, const GamepadCallback &on_disconnect) {
+    on_connected = on_connect;
+    on_disconnected = on_disconnect;
+    for (int i = 0; i < BP32_MAX_GAMEPADS; i++) sim_gamepads[i].idx = i;
+}
+
+bool Bluepad32::update() {
+    std::lock_guard<std::recursive_mutex> guard(gamepad_lock);
+    bool fresh = false;
+
+    for (int i = 0; i < BP32_MAX_GAMEPADS; i++) {
+        Controller &ctl = sim_gamepads[i];
+        ctl.has_data = false;
+
+        if (pending_connect[i] && !ctl.connected) {
+            ctl.connected = true;
+            ctl.state = sim_gamepad_state();
+            if (on_connected) on_connected(&ctl);
+        }
+        pending_connect[i] = false;
+
+        if (pending_report[i] && ctl.connected) {
+            ctl.state = pending_state[i];
+            ctl.has_data = true;
+            fresh = true;
+        }
+        pending_report[i] = false;
+
+        if (pending_disconnect[i] && ctl.connected) {
+            ctl.connected = false;
+            if (on_disconnected) on_disconnected(&ctl);
+        }
+        pending_disconnect[i] = false;
+    }
+
+    return fresh;
+}
+
+// feedback sent to each gamepad (the strong and weak rumble motors are always given the same strength)
+static std::mutex feedback_lock;
+static sim_feedback_record feedback[BP32_MAX_GAMEPADS];
+static bool feedback_sent[BP32_MAX_GAMEPADS];
+
+static sim_feedback_record &sim_feedback(int idx) {
+    if (!feedback_sent[idx]) feedback[idx] = {0, -1, -1, -1};
+    feedback_sent[idx] = true;
+    feedback[idx].commands++;
+    return feedback[idx];
+}
+
+bool sim_feedback_info(int idx, sim_feedback_record &record) {
+    std::lock_guard<std::mutex> guard(feedback_lock);
+    if (idx < 0 || idx >= BP32_MAX_GAMEPADS || !feedback_sent[idx]) return false;
+    record = feedback[idx];
+    return true;
+}
+
+void Controller::setColorLED(uint8_t r, uint8_t g, uint8_t b) {
+    std::lock_guard<std::mutex> guard(feedback_lock);
+    sim_feedback(idx).colour = (r << 16) | (g << 8) | b;
+}
+void Controller::setPlayerLEDs(uint8_t leds) {
+    std::lock_guard<std::mutex> guard(feedback_lock);
+    sim_feedback(idx).leds = leds;
+}
+void Controller::playDualRumble(uint16_t delayed_start_ms, uint16_t duration_ms, uint8_t weak_magnitude, uint8_t strong_magnitude) {
+    (void) delayed_start_ms; (void) duration_ms; (void) weak_magnitude;
+    std::lock_guard<std::mutex> guard(feedback_lock);
+    sim_feedback(idx).rumble = strong_magnitude;
+}
+void Controller::disconnect() { sim_gamepad_disconnect(idx); }
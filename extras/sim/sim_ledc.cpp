@@ -0,0 +1,120 @@
+/*
+ * a model of the esp32's LEDC (pwm) peripheral, driven through the driver/ledc.h stand-in
+ *
+ * each timer counts from when it was configured, and every channel on a timer starts a pulse
+ * at the start of each of the timer's periods.  a new duty cycle is latched at the start of the
+ * channel's next period, like on the real peripheral, so each duty update is recorded along with
+ * the time its first pulse starts.  pulses between updates are all the same, so they aren't
+ * recorded individually.
+ *
+ * every update also goes to the output recorder and esc model as a servo pulse width, which is
+ * worked out from the pulse width the same way a real esc detects the protocol: pulses shorter
+ * than 100 µs are OneShot42, pulses shorter than 500 µs are OneShot125, and anything longer is
+ * normal servo pwm.
+*/
+
+#include <cmath>
+#include <mutex>
+#include <Arduino.h>
+#include <driver/ledc.h>
+#include "sim.h"
+
+struct sim_ledc_timer {
+    bool     configured = false;
+    uint32_t freq = 0;
+    uint8_t  bits = 0;
+    uint64_t origin_us = 0;         // time the timer started counting
+};
+
+struct sim_ledc_channel {
+    bool         configured = false;
+    int          gpio = -1;
+    ledc_timer_t timer = LEDC_TIMER_0;
+    uint32_t     duty = 0;          // duty set by ledc_set_duty(), which is latched by ledc_update_duty()
+};
+
+static sim_ledc_timer   timers[LEDC_SPEED_MODE_MAX][LEDC_TIMER_MAX];
+static sim_ledc_channel channels[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX];
+static std::vector<sim_pulse_record> pulse_log;
+static std::mutex ledc_lock;
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *conf) {
+    if (conf->speed_mode >= LEDC_SPEED_MODE_MAX || conf->timer_num >= LEDC_TIMER_MAX || conf->freq_hz == 0) return ESP_ERR_INVALID_ARG;
+    if (((uint64_t) conf->freq_hz << conf->duty_resolution) > 80000000) return ESP_FAIL;     // the clock isn't fast enough
+
+    std::lock_guard<std::mutex> guard(ledc_lock);
+    timers[conf->speed_mode][conf->timer_num] = {true, conf->freq_hz, (uint8_t) conf->duty_resolution, (uint64_t) micros()};
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *conf) {
+    if (conf->speed_mode >= LEDC_SPEED_MODE_MAX || conf->channel >= LEDC_CHANNEL_MAX || conf->timer_sel >= LEDC_TIMER_MAX) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(ledc_lock);
+    if (!timers[conf->speed_mode][conf->timer_sel].configured) return ESP_FAIL;
+    channels[conf->speed_mode][conf->channel] = {true, conf->gpio_num, conf->timer_sel, conf->duty};
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty) {
+    if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(ledc_lock);
+    channels[mode][channel].duty = duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel) {
+    if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+
+    sim_alloc_exempt exempt;
+    uint64_t now = micros();
+    int32_t us;
+    uint8_t pin;
+    {
+        std::lock_guard<std::mutex> guard(ledc_lock);
+        const sim_ledc_channel &ch = channels[mode][channel];
+        if (!ch.configured) return ESP_FAIL;
+        const sim_ledc_timer &timer = timers[mode][ch.timer];
+
+        // the new duty starts with the next period
+        double period_us = 1e6 / timer.freq;
+        double start_us = timer.origin_us + std::ceil((now - timer.origin_us) / period_us) * period_us;
+        uint32_t width_ns = llround(ch.duty * 1e9 / ((double) timer.freq * (1ULL << timer.bits)));
+        pin = ch.gpio;
+
+        // work out the protocol from the pulse width
+        double width_us = width_ns / 1000.0;
+        us = lround(width_us < 100 ? width_us * 24 : width_us < 500 ? width_us * 8 : width_us);
+
+        if (sim_recording) pulse_log.push_back({now, start_us, pin, width_ns, (uint32_t) llround(period_us * 1000)});
+    }
+
+    sim_esc_pulse(pin, us, now);
+    sim_record_output(SIM_OUT_PWM, pin, us);
+    return ESP_OK;
+}
+
+esp_err_t ledc_stop(ledc_mode_t mode, ledc_channel_t channel, uint32_t idle_level) {
+    (void) idle_level;
+    if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(ledc_lock);
+    channels[mode][channel].configured = false;
+    return ESP_OK;
+}
+
+bool sim_last_pulse(uint8_t pin, sim_pulse_record &record) {
+    std::lock_guard<std::mutex> guard(ledc_lock);
+    for (auto it = pulse_log.rbegin(); it != pulse_log.rend(); it++) {
+        if (it->pin == pin) {
+            record = *it;
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::vector<sim_pulse_record> &sim_pulse_log() {
+    return pulse_log;
+}
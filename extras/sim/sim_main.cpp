@@ -0,0 +1,582 @@
+/*
+ * bbrx simulator driver
+ *
+ * runs the bbrx sketch on the host against the stand-in libraries in stubs/, feeds it
+ * controller input from a script, and records every pwm / gpio write it makes.
+ *
+ * usage: bbrx_sim [-c config.yml] [-o outputs.csv] [-p pulses.csv] [-l] [-q] script.sim
+ *
+ *   -c  config file to load (default: the default bindings)
+ *   -o  write every recorded output to a csv file
+ *   -p  write every duty cycle update made by the LEDC model to a csv file
+ *   -l  lockstep mode: instead of running the real scheduler, run the control loop
+ *       directly, as fast as possible, against a virtual clock which moves one control
+ *       period per tick.  the output sequence is deterministic, and the (host) time
+ *       taken per control tick is reported
+ *   -q  don't print bbrx's log output
+ *
+ * see docs/dev/simulator.md for the script format.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "sim.h"
+#include "config.h"
+#include "controllers.h"
+#include "event_manager.h"
+#include "alloc_check.h"
+#include "status_led.h"
+#include "feedback.h"
+
+// sketch entry points (bbrx.ino)
+void setup();
+void loop();
+
+// input hand-over counters (controllers.cpp), used to keep lockstep mode in step with the input task
+extern bb_input_stats input_stats;
+
+static bool lockstep = false;
+static uint32_t report_rate = 250;                      // rate at which ramps send reports (Hz)
+static sim_gamepad_state pad_state[BP32_MAX_GAMEPADS];  // current scripted state of each gamepad
+static bool pad_connected[BP32_MAX_GAMEPADS];
+static uint32_t pad_stream[BP32_MAX_GAMEPADS];          // period at which each gamepad resends its state while waiting (ms, 0 = only when scripted)
+static uint32_t pad_stream_due[BP32_MAX_GAMEPADS];      // time until each streaming gamepad's next report (ms)
+static std::vector<uint64_t> report_times;              // time of each scripted report (µs)
+static uint64_t lockstep_ticks = 0;
+static double lockstep_seconds = 0;
+static int failures = 0;
+
+//-------------------------------------------
+// gamepad fields
+//-------------------------------------------
+
+struct sim_field {
+    const char *name;
+    int32_t  sim_gamepad_state::*value;     // for axes
+    uint16_t button;                        // for buttons (0 if not a button)
+    uint8_t  misc;                          // for misc buttons
+    uint8_t  dpad;                          // for dpad directions
+};
+
+static const sim_field fields[] = {
+    {"lx",       &sim_gamepad_state::axis_x},
+    {"ly",       &sim_gamepad_state::axis_y},
+    {"rx",       &sim_gamepad_state::axis_rx},
+    {"ry",       &sim_gamepad_state::axis_ry},
+    {"brake",    &sim_gamepad_state::brake},
+    {"throttle", &sim_gamepad_state::throttle},
+    {"dx",       &sim_gamepad_state::delta_x},
+    {"dy",       &sim_gamepad_state::delta_y},
+    {"scroll",   &sim_gamepad_state::scroll_wheel},
+    {"a",        nullptr, BUTTON_A},
+    {"b",        nullptr, BUTTON_B},
+    {"x",        nullptr, BUTTON_X},
+    {"y",        nullptr, BUTTON_Y},
+    {"l1",       nullptr, BUTTON_SHOULDER_L},
+    {"r1",       nullptr, BUTTON_SHOULDER_R},
+    {"l2",       nullptr, BUTTON_TRIGGER_L},
+    {"r2",       nullptr, BUTTON_TRIGGER_R},
+    {"l3",       nullptr, BUTTON_THUMB_L},
+    {"r3",       nullptr, BUTTON_THUMB_R},
+    {"system",   nullptr, 0, MISC_BUTTON_SYSTEM},
+    {"select",   nullptr, 0, MISC_BUTTON_SELECT},
+    {"start",    nullptr, 0, MISC_BUTTON_START},
+    {"capture",  nullptr, 0, MISC_BUTTON_CAPTURE},
+    {"up",       nullptr, 0, 0, 0x01},
+    {"down",     nullptr, 0, 0, 0x02},
+    {"right",    nullptr, 0, 0, 0x04},
+    {"left",     nullptr, 0, 0, 0x08},
+};
+
+static bool set_field(sim_gamepad_state &state, const std::string &name, int32_t value) {
+
+    // the gyro and accelerometer are arrays, so handle them separately
+    static const char *motion[] = {"gyro_x", "gyro_y", "gyro_z", "accel_x", "accel_y", "accel_z"};
+    for (int i = 0; i < 6; i++) {
+        if (name == motion[i]) {
+            (i < 3 ? state.gyro : state.accel)[i % 3] = value;
+            return true;
+        }
+    }
+    if (name == "battery") { state.battery = value; return true; }
+
+    for (const sim_field &f : fields) {
+        if (name != f.name) continue;
+        if      (f.value)  state.*f.value = value;
+        else if (f.button) state.buttons      = value ? (state.buttons | f.button)    : (state.buttons & ~f.button);
+        else if (f.misc)   state.misc_buttons = value ? (state.misc_buttons | f.misc) : (state.misc_buttons & ~f.misc);
+        else               state.dpad         = value ? (state.dpad | f.dpad)         : (state.dpad & ~f.dpad);
+        return true;
+    }
+
+    return false;
+}
+
+//-------------------------------------------
+// running bbrx
+//-------------------------------------------
+
+// in lockstep mode, wait for the input task to publish a snapshot after a gamepad change
+static void wait_for_input_task(uint32_t published) {
+    if (!lockstep) return;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    while (((volatile bb_input_stats &) input_stats).published == published) {
+        if (std::chrono::steady_clock::now() > deadline) break;
+        std::this_thread::yield();
+    }
+}
+
+static void send_report(int pad) {
+    uint32_t published = input_stats.published;
+    report_times.push_back(micros());
+    sim_gamepad_report(pad, pad_state[pad]);
+    if (pad_connected[pad]) wait_for_input_task(published);
+}
+
+// let bbrx run for a while
+static void advance(uint32_t ms) {
+
+    if (lockstep) {
+        // run as many control ticks as would have happened in this time
+        uint32_t ticks = ((uint64_t) ms * CONTROL_RATE + 999) / 1000;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < ticks; i++) {
+            alloc_check_begin();
+            event_manager_update();
+            alloc_check_end();
+            sim_clock_advance(1000000 / CONTROL_RATE);
+        }
+        lockstep_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        lockstep_ticks += ticks;
+        leds_update();
+        feedback_update();
+    }
+    else {
+        // let the scheduler run bbrx in real time, while running the main loop
+        unsigned long start = millis();
+        while (millis() - start < ms) loop();
+    }
+
+}
+
+// let bbrx run for a while, with any streaming gamepads sending reports at their rate
+static void wait(uint32_t ms) {
+
+    while (ms > 0) {
+
+        // run until the next streamed report is due
+        uint32_t step = ms;
+        for (int pad = 0; pad < BP32_MAX_GAMEPADS; pad++) {
+            if (pad_connected[pad] && pad_stream[pad]) step = std::min(step, pad_stream_due[pad]);
+        }
+        advance(step);
+        ms -= step;
+
+        for (int pad = 0; pad < BP32_MAX_GAMEPADS; pad++) {
+            if (!pad_connected[pad] || !pad_stream[pad]) continue;
+            pad_stream_due[pad] -= step;
+            if (pad_stream_due[pad] == 0) {
+                send_report(pad);
+                pad_stream_due[pad] = pad_stream[pad];
+            }
+        }
+    }
+
+}
+
+// the same as setup(), except the scheduler isn't started
+static void setup_lockstep() {
+    leds_setup();
+    leds_set_state(LED_LOADING);
+    load_config();
+    controller_setup();
+    event_manager_setup();
+    for (auto &b : bindings) initialise_binding(b);
+    compile_bindings();
+    leds_set_state(LED_IDLE);
+}
+
+//-------------------------------------------
+// script
+//-------------------------------------------
+
+static void fail(int line, const std::string &msg) {
+    fprintf(stderr, "script line %d: FAIL %s\n", line, msg.c_str());
+    failures++;
+}
+
+static bool run_script(const char *path) {
+
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "couldn't open script %s\n", path);
+        return false;
+    }
+
+    std::string text;
+    int line_number = 0;
+    while (std::getline(file, text)) {
+        line_number++;
+
+        // strip comments
+        size_t hash = text.find('#');
+        if (hash != std::string::npos) text.resize(hash);
+
+        std::istringstream line(text);
+        std::string cmd;
+        if (!(line >> cmd)) continue;
+
+        int pad = 0;
+        if (cmd == "connect" || cmd == "disconnect" || cmd == "set" || cmd == "ramp" || cmd == "stream") {
+            if (!(line >> pad) || pad < 0 || pad >= BP32_MAX_GAMEPADS) {
+                fprintf(stderr, "script line %d: invalid gamepad index\n", line_number);
+                return false;
+            }
+        }
+
+        if (cmd == "connect") {
+            uint32_t published = input_stats.published;
+            pad_state[pad] = sim_gamepad_state();
+            pad_connected[pad] = true;
+            sim_gamepad_connect(pad);
+            wait_for_input_task(published);
+        }
+        else if (cmd == "disconnect") {
+            uint32_t published = input_stats.published;
+            pad_connected[pad] = false;
+            sim_gamepad_disconnect(pad);
+            wait_for_input_task(published);
+        }
+        else if (cmd == "set") {
+            // set <pad> <field> <value> [<field> <value> ...]
+            std::string field;
+            int32_t value;
+            while (line >> field >> value) {
+                if (!set_field(pad_state[pad], field, value)) {
+                    fprintf(stderr, "script line %d: unknown field %s\n", line_number, field.c_str());
+                    return false;
+                }
+            }
+            send_report(pad);
+        }
+        else if (cmd == "ramp") {
+            // ramp <pad> <field> <from> <to> <ms>
+            std::string field;
+            int32_t from, to;
+            uint32_t ms;
+            if (!(line >> field >> from >> to >> ms) || !set_field(pad_state[pad], field, from)) {
+                fprintf(stderr, "script line %d: expected ramp <pad> <field> <from> <to> <ms>\n", line_number);
+                return false;
+            }
+            uint32_t period = 1000 / report_rate;
+            uint32_t steps = std::max<uint32_t>(ms / std::max<uint32_t>(period, 1), 1);
+            for (uint32_t i = 0; i <= steps; i++) {
+                set_field(pad_state[pad], field, from + (int64_t) (to - from) * i / steps);
+                send_report(pad);
+                if (i < steps) advance(period);
+            }
+        }
+        else if (cmd == "stream") {
+            // stream <pad> <hz>: keep resending the gamepad's state while waiting (0 = stop)
+            uint32_t hz;
+            if (!(line >> hz) || hz > 1000) {
+                fprintf(stderr, "script line %d: stream rate must be between 0 and 1000 Hz\n", line_number);
+                return false;
+            }
+            pad_stream[pad] = hz ? std::max<uint32_t>(1000 / hz, 1) : 0;
+            pad_stream_due[pad] = pad_stream[pad];
+        }
+        else if (cmd == "rate") {
+            if (!(line >> report_rate) || report_rate == 0 || report_rate > 1000) {
+                fprintf(stderr, "script line %d: report rate must be between 1 and 1000 Hz\n", line_number);
+                return false;
+            }
+        }
+        else if (cmd == "serial") {
+            // serial <text>: send text to bbrx over serial (it's read by loop(), so this does nothing in lockstep mode)
+            std::string input;
+            std::getline(line >> std::ws, input);
+            Serial.sim_input(input);
+        }
+        else if (cmd == "wait") {
+            uint32_t ms;
+            if (!(line >> ms)) {
+                fprintf(stderr, "script line %d: expected wait <ms>\n", line_number);
+                return false;
+            }
+            wait(ms);
+        }
+        else if (cmd == "expect") {
+            // expect pwm <pin> <value> [tolerance]
+            // expect gpio <pin> <level>
+            // expect esc <pin> <min %> <max %>
+            // expect pulse <pin> <ns> [tolerance]
+            // expect dshot <pin> <value> [tolerance]
+            // expect rumble <pad> <strength> [tolerance]
+            // expect colour <pad> <0xRRGGBB>
+            // expect leds <pad> <bitmask>
+            std::string kind, first;
+            int pin;
+            int32_t a, b = 0;
+            if (!(line >> kind >> pin >> first)) {
+                fprintf(stderr, "script line %d: expected expect <pwm|gpio|esc|pulse|dshot|rumble|colour|leds> <pin> ...\n", line_number);
+                return false;
+            }
+            a = strtol(first.c_str(), nullptr, 0);
+            line >> b;
+
+            int32_t value;
+            char msg[128];
+            if (kind == "pwm" || kind == "gpio" || kind == "dshot") {
+                sim_output_kind k = (kind == "pwm") ? SIM_OUT_PWM : (kind == "gpio") ? SIM_OUT_GPIO : SIM_OUT_DSHOT;
+                if (!sim_last_output(k, pin, value)) fail(line_number, kind + " " + std::to_string(pin) + " was never written");
+                else if (std::abs(value - a) > b) {
+                    snprintf(msg, sizeof(msg), "%s %d is %d, expected %d", kind.c_str(), pin, value, a);
+                    fail(line_number, msg);
+                }
+            }
+            else if (kind == "esc") {
+                float speed = sim_esc_speed(pin, micros()) * 100;
+                if (!sim_esc_exists(pin)) fail(line_number, "no esc on pin " + std::to_string(pin));
+                else if (speed < a || speed > b) {
+                    snprintf(msg, sizeof(msg), "esc %d speed is %.1f%%, expected %d%% to %d%%", pin, speed, a, b);
+                    fail(line_number, msg);
+                }
+            }
+            else if (kind == "pulse") {
+                sim_pulse_record pulse;
+                if (!sim_last_pulse(pin, pulse)) fail(line_number, "no pulses on pin " + std::to_string(pin));
+                else if (std::abs((int64_t) pulse.width_ns - a) > b) {
+                    snprintf(msg, sizeof(msg), "pulse %d is %u ns, expected %d ns", pin, pulse.width_ns, a);
+                    fail(line_number, msg);
+                }
+            }
+            else if (kind == "rumble" || kind == "colour" || kind == "leds") {
+                sim_feedback_record feedback;
+                if (!sim_feedback_info(pin, feedback)) {
+                    fail(line_number, "no feedback was sent to gamepad " + std::to_string(pin));
+                    continue;
+                }
+                value = (kind == "rumble") ? feedback.rumble : (kind == "colour") ? feedback.colour : feedback.leds;
+                if (std::abs(value - a) > b) {
+                    snprintf(msg, sizeof(msg), "%s of gamepad %d is 0x%x, expected 0x%x", kind.c_str(), pin, value, a);
+                    fail(line_number, msg);
+                }
+            }
+            else {
+                fprintf(stderr, "script line %d: unknown expectation %s\n", line_number, kind.c_str());
+                return false;
+            }
+        }
+        else {
+            fprintf(stderr, "script line %d: unknown command %s\n", line_number, cmd.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//-------------------------------------------
+// results
+//-------------------------------------------
+
+static void write_outputs(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "couldn't open %s\n", path);
+        return;
+    }
+
+    fprintf(f, "time_us,kind,pin,value,esc_speed\n");
+    for (const sim_output_record &r : sim_output_log()) {
+        if      (r.kind == SIM_OUT_PWM)   fprintf(f, "%llu,pwm,%u,%d,%.1f\n",   (unsigned long long) r.time_us, r.pin, r.value, sim_esc_speed(r.pin, r.time_us) * 100);
+        else if (r.kind == SIM_OUT_DSHOT) fprintf(f, "%llu,dshot,%u,%d,%.1f\n", (unsigned long long) r.time_us, r.pin, r.value, sim_esc_speed(r.pin, r.time_us) * 100);
+        else                              fprintf(f, "%llu,gpio,%u,%d,\n",      (unsigned long long) r.time_us, r.pin, r.value);
+    }
+    fclose(f);
+}
+
+static void write_pulses(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "couldn't open %s\n", path);
+        return;
+    }
+
+    fprintf(f, "write_us,start_us,pin,width_ns,period_ns\n");
+    for (const sim_pulse_record &p : sim_pulse_log()) {
+        fprintf(f, "%llu,%.1f,%u,%u,%u\n", (unsigned long long) p.write_us, p.start_us, p.pin, p.width_ns, p.period_ns);
+    }
+    fclose(f);
+}
+
+// for each pin, how long duty cycle updates waited for the next pulse to start
+static void print_pulses() {
+    struct pin_pulses {
+        uint32_t updates = 0;
+        double   total_wait = 0;
+        double   max_wait = 0;
+        sim_pulse_record last;
+    } pins[256];
+
+    for (const sim_pulse_record &p : sim_pulse_log()) {
+        pin_pulses &pin = pins[p.pin];
+        double wait = p.start_us - p.write_us;
+        pin.updates++;
+        pin.total_wait += wait;
+        pin.max_wait = std::max(pin.max_wait, wait);
+        pin.last = p;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        const pin_pulses &pin = pins[i];
+        if (!pin.updates) continue;
+        printf("pulses on pin %d: %.0f Hz, last width %u ns, %u updates, wait for next pulse mean %.0f µs, max %.0f µs\n", i,
+            1e9 / pin.last.period_ns, pin.last.width_ns, pin.updates, pin.total_wait / pin.updates, pin.max_wait);
+    }
+}
+
+// for each report, the time until bbrx first changed an output in response to it
+static void print_latency() {
+    const auto &log = sim_output_log();
+    int32_t last_value[SIM_OUT_DSHOT + 1][256];
+    bool written[SIM_OUT_DSHOT + 1][256] = {};
+    uint64_t total = 0, lo = UINT64_MAX, hi = 0;
+    uint32_t count = 0;
+
+    size_t r = 0;
+    for (size_t i = 0; i < report_times.size(); i++) {
+        uint64_t start = report_times[i];
+        uint64_t end = (i + 1 < report_times.size()) ? report_times[i + 1] : UINT64_MAX;
+
+        for (; r < log.size() && log[r].time_us < end; r++) {
+            const sim_output_record &rec = log[r];
+            bool changed = !written[rec.kind][rec.pin] || last_value[rec.kind][rec.pin] != rec.value;
+            written[rec.kind][rec.pin] = true;
+            last_value[rec.kind][rec.pin] = rec.value;
+
+            if (changed && rec.time_us >= start) {
+                uint64_t latency = rec.time_us - start;
+                total += latency;
+                lo = std::min(lo, latency);
+                hi = std::max(hi, latency);
+                count++;
+                start = UINT64_MAX;     // only count the first change after each report
+            }
+        }
+    }
+
+    if (count) printf("input-to-output latency: %u reports, min %llu µs, mean %llu µs, max %llu µs\n",
+        count, (unsigned long long) lo, (unsigned long long) (total / count), (unsigned long long) hi);
+}
+
+static void print_summary() {
+    const auto &log = sim_output_log();
+    uint32_t counts[SIM_OUT_DSHOT + 1] = {};
+    for (const sim_output_record &r : log) counts[r.kind]++;
+
+    printf("\n=== bbrx sim ===\n");
+    printf("%zu scripted reports, %u pwm writes, %u gpio writes, %u dshot changes\n", report_times.size(), counts[SIM_OUT_PWM], counts[SIM_OUT_GPIO], counts[SIM_OUT_DSHOT]);
+    if (lockstep && lockstep_ticks) {
+        printf("control loop: %llu ticks, %.0f ns per tick (%.0f ticks/s)\n",
+            (unsigned long long) lockstep_ticks, lockstep_seconds * 1e9 / lockstep_ticks, lockstep_ticks / lockstep_seconds);
+    }
+    print_latency();
+
+    uint64_t now = micros();
+    for (int pin = 0; pin < 256; pin++) {
+        if (!sim_esc_exists(pin)) continue;
+        const char *armed = sim_esc_armed(pin, now) ? "armed" : "not armed";
+        int32_t value = 0;
+        sim_dshot_record dshot;
+        if (sim_dshot_info(pin, dshot)) {
+            printf("esc on pin %d: DShot at %u bit/s, last value %d, %u frames (%u bad), %s, speed %.1f%%\n", pin,
+                dshot.bitrate, dshot.value, dshot.frames, dshot.bad_frames, armed, sim_esc_speed(pin, now) * 100);
+        }
+        else {
+            sim_last_output(SIM_OUT_PWM, pin, value);
+            printf("esc on pin %d: last pulse %d µs, %s, speed %.1f%%\n", pin, value, armed, sim_esc_speed(pin, now) * 100);
+        }
+    }
+
+    print_pulses();
+
+    for (int pad = 0; pad < BP32_MAX_GAMEPADS; pad++) {
+        sim_feedback_record feedback;
+        if (!sim_feedback_info(pad, feedback)) continue;
+        printf("feedback to gamepad %d: %u commands, last rumble %d, colour 0x%06x, player leds 0x%x\n", pad,
+            feedback.commands, feedback.rumble, feedback.colour, feedback.leds);
+    }
+
+    if (failures) printf("%d expectation(s) failed\n", failures);
+}
+
+int main(int argc, char **argv) {
+
+    const char *config = nullptr;
+    const char *outputs = nullptr;
+    const char *pulses = nullptr;
+    bool quiet = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:o:p:lq")) != -1) {
+        switch (opt) {
+            case 'c': config = optarg; break;
+            case 'o': outputs = optarg; break;
+            case 'p': pulses = optarg; break;
+            case 'l': lockstep = true; break;
+            case 'q': quiet = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-c config.yml] [-o outputs.csv] [-p pulses.csv] [-l] [-q] script.sim\n", argv[0]);
+                return 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-c config.yml] [-o outputs.csv] [-p pulses.csv] [-l] [-q] script.sim\n", argv[0]);
+        return 2;
+    }
+
+    // point the filesystem at the config file (or at nothing, so the defaults are used)
+    sim_map_file(CONFIG_FILE_PATH, config ? config : "/nonexistent");
+
+    // bbrx logs to stdout, so silence it if asked to
+    int saved_stdout = -1;
+    if (quiet) {
+        fflush(stdout);
+        saved_stdout = dup(STDOUT_FILENO);
+        if (!freopen("/dev/null", "w", stdout)) return 1;
+    }
+
+    if (lockstep) {
+        sim_clock_virtual(true);
+        setup_lockstep();
+    }
+    else          setup();
+
+    bool ok = run_script(argv[optind]);
+
+    if (quiet) {
+        fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+
+    // stop recording, since the control task is still running
+    sim_recording = false;
+
+    if (outputs) write_outputs(outputs);
+    if (pulses) write_pulses(pulses);
+    print_summary();
+
+    fflush(stdout);
+    _exit(!ok ? 2 : (failures ? 1 : 0));
+}
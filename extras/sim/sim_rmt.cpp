@@ -0,0 +1,123 @@
+/*
+ * a model of the esp32's RMT peripheral, driven through the driver/rmt.h stand-in
+ *
+ * bbrx only uses the RMT to send DShot, so every block of items written to a channel is decoded
+ * as a DShot frame, the same way an ESC does it: each item is one bit, which is a 1 if it's high
+ * for more than half of the bit.  frames which aren't 16 bits long or have the wrong checksum
+ * are counted as bad.
+ *
+ * frames are sent on every tick, so only frames which are different to the last one on the pin
+ * go to the output recorder and esc model.
+*/
+
+#include <map>
+#include <mutex>
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include "sim.h"
+
+#define SIM_RMT_CLOCK   80000000    // clock the RMT channels count, before the divider (Hz)
+
+struct sim_rmt_channel {
+    bool    configured = false;
+    bool    installed = false;
+    int     gpio = -1;
+    uint8_t clk_div = 1;
+};
+
+struct sim_dshot_pin {
+    sim_dshot_record record = {};
+    int32_t          last = -2;     // last frame (-1 = bad frame, -2 = nothing yet)
+};
+
+static sim_rmt_channel channels[RMT_CHANNEL_MAX];
+static std::map<uint8_t, sim_dshot_pin> pins;
+static std::mutex rmt_lock;
+
+esp_err_t rmt_config(const rmt_config_t *conf) {
+    if (conf->channel >= RMT_CHANNEL_MAX || conf->rmt_mode != RMT_MODE_TX || conf->clk_div == 0) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(rmt_lock);
+    sim_rmt_channel &ch = channels[conf->channel];
+    ch.configured = true;
+    ch.gpio = conf->gpio_num;
+    ch.clk_div = conf->clk_div;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags) {
+    (void) rx_buf_size;
+    (void) intr_alloc_flags;
+    if (channel >= RMT_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(rmt_lock);
+    if (channels[channel].installed) return ESP_ERR_INVALID_STATE;
+    channels[channel].installed = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel) {
+    if (channel >= RMT_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(rmt_lock);
+    if (!channels[channel].installed) return ESP_ERR_INVALID_STATE;
+    channels[channel] = {};
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *items, int count, bool wait_tx_done) {
+    (void) wait_tx_done;
+    if (channel >= RMT_CHANNEL_MAX || items == nullptr) return ESP_ERR_INVALID_ARG;
+
+    sim_alloc_exempt exempt;
+    uint64_t now = micros();
+    int32_t value = -1;
+    uint8_t pin;
+    bool changed;
+    {
+        std::lock_guard<std::mutex> guard(rmt_lock);
+        const sim_rmt_channel &ch = channels[channel];
+        if (!ch.configured || !ch.installed) return ESP_ERR_INVALID_STATE;
+        pin = ch.gpio;
+
+        // decode the bits, and check they're all the same length
+        uint32_t frame = 0, bit_ticks = 0;
+        bool good = (count == 16);
+        for (int i = 0; i < count && good; i++) {
+            const rmt_item32_t &item = items[i];
+            uint32_t ticks = item.duration0 + item.duration1;
+            if (item.level0 != 1 || item.level1 != 0 || ticks == 0) good = false;
+            if (i == 0) bit_ticks = ticks;
+            else if (ticks + 1 < bit_ticks || ticks > bit_ticks + 1) good = false;
+            frame = (frame << 1) | (item.duration0 * 2 > ticks ? 1 : 0);
+        }
+
+        // check the checksum
+        uint32_t data = frame >> 4;
+        if (good && ((data ^ (data >> 4) ^ (data >> 8)) & 0x0F) == (frame & 0x0F)) value = data >> 1;
+
+        sim_dshot_pin &p = pins[pin];
+        p.record.frames++;
+        if (value < 0) p.record.bad_frames++;
+        else {
+            p.record.value = value;
+            p.record.bitrate = bit_ticks ? SIM_RMT_CLOCK / ch.clk_div / bit_ticks : 0;
+        }
+        changed = (value != p.last);
+        p.last = value;
+    }
+
+    if (changed) {
+        if (value >= 0) sim_esc_dshot(pin, value, now);
+        sim_record_output(SIM_OUT_DSHOT, pin, value);
+    }
+    return ESP_OK;
+}
+
+bool sim_dshot_info(uint8_t pin, sim_dshot_record &record) {
+    std::lock_guard<std::mutex> guard(rmt_lock);
+    auto it = pins.find(pin);
+    if (it == pins.end()) return false;
+    record = it->second.record;
+    return true;
+}
@@ -0,0 +1,169 @@
+/*
+ * host implementations of the FreeRTOS and esp_timer stand-ins in stubs/
+ *
+ * every task and periodic timer gets its own host thread.  this doesn't model task
+ * priorities or core affinity, but it does model the concurrency between them.
+*/
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_timer.h>
+#include "sim.h"
+
+//-------------------------------------------
+// tasks
+//-------------------------------------------
+
+struct sim_task {
+    const char *name;
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notifications = 0;
+};
+
+static thread_local sim_task *current_task = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+    (void) stack; (void) priority; (void) core;
+    sim_task *task = new sim_task();
+    task->name = name;
+    if (handle) *handle = task;
+    std::thread([task, fn, arg]() {
+        current_task = task;
+        fn(arg);
+    }).detach();
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    // threads which weren't started as tasks (like main) get a task of their own.  this can't
+    // allocate, since it's called from operator new when ALLOC_CHECK is defined
+    static thread_local sim_task thread_task;
+    if (current_task == nullptr) current_task = &thread_task;
+    return current_task;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount() {
+    return millis();
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifications++;
+    }
+    task->cv.notify_one();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t timeout) {
+    sim_task *task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> guard(task->lock);
+    auto ready = [task]() { return task->notifications > 0; };
+    if (timeout == portMAX_DELAY) task->cv.wait(guard, ready);
+    else task->cv.wait_for(guard, std::chrono::milliseconds(timeout), ready);
+
+    uint32_t count = task->notifications;
+    if (count > 0) task->notifications = clear_on_exit ? 0 : count - 1;
+    return count;
+}
+
+//-------------------------------------------
+// queues
+//-------------------------------------------
+
+struct sim_queue {
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    sim_queue *queue = new sim_queue();
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t timeout) {
+    (void) timeout;
+    sim_alloc_exempt exempt;     // real queues copy items into storage allocated when they're created
+    {
+        std::lock_guard<std::mutex> guard(queue->lock);
+        if (queue->items.size() >= queue->length) return errQUEUE_FULL;
+        const uint8_t *bytes = (const uint8_t *) item;
+        queue->items.emplace_back(bytes, bytes + queue->item_size);
+    }
+    queue->cv.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    auto ready = [queue]() { return !queue->items.empty(); };
+    if (timeout == portMAX_DELAY) queue->cv.wait(guard, ready);
+    else if (timeout > 0) queue->cv.wait_for(guard, std::chrono::milliseconds(timeout), ready);
+
+    if (queue->items.empty()) return pdFALSE;
+    memcpy(item, queue->items.front().data(), queue->item_size);
+    queue->items.pop_front();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->items.size();
+}
+
+//-------------------------------------------
+// esp_timer
+//-------------------------------------------
+
+struct sim_timer {
+    esp_timer_create_args_t args;
+    std::atomic<uint32_t> generation{0};    // bumped by every start and stop, so a stopped timer's thread knows to finish
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle) {
+    sim_timer *timer = new sim_timer();
+    timer->args = *args;
+    *handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    uint32_t generation = ++timer->generation;
+    std::thread([timer, period_us, generation]() {
+        auto next = std::chrono::steady_clock::now();
+        while (timer->generation == generation) {
+            next += std::chrono::microseconds(period_us);
+            std::this_thread::sleep_until(next);
+            if (timer->generation == generation) timer->args.callback(timer->args.arg);
+        }
+    }).detach();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    timer->generation++;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    return micros();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+/*
+ * host stand-in for the Arduino core, used by the bbrx simulator
+ *
+ * only the parts of the Arduino / arduino-esp32 API that bbrx actually touches are
+ * provided.  time is taken from the host's monotonic clock (relative to sim start),
+ * and every gpio write is forwarded to the simulator's output recorder.
+*/
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH    0x1
+#define LOW     0x0
+#define INPUT   0x01
+#define OUTPUT  0x03
+
+#define ARDUINO_RUNNING_CORE 1
+
+// simulator clock (see sim_hal.cpp)
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+
+// arduino-esp32's map(), including its integer rounding behaviour
+inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    const long run = in_max - in_min;
+    if (run == 0) return -1;
+    const long rise = out_max - out_min;
+    const long delta = x - in_min;
+    return (delta * rise) / run + out_min;
+}
+
+class String : public std::string {
+public:
+    String() {}
+    String(const char *s) : std::string(s) {}
+    String(const std::string &s) : std::string(s) {}
+};
+
+class HardwareSerial {
+public:
+    void begin(unsigned long baud) { (void) baud; }
+    size_t setTxBufferSize(size_t size) { return size; }
+    int printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vprintf(fmt, args);
+        va_end(args);
+        return n;
+    }
+    size_t print(const char *s)        { return fputs(s, stdout) >= 0 ? strlen(s) : 0; }
+    size_t print(unsigned long v)      { return ::printf("%lu", v); }
+    size_t println(const char *s = "") { size_t n = print(s); putchar('\n'); return n + 1; }
+    size_t println(unsigned long v)    { size_t n = print(v); putchar('\n'); return n + 1; }
+    int available()                    { return rx.size() - rx_pos; }
+    int read()                         { return available() ? rx[rx_pos++] : -1; }
+
+    // simulator side: queue up characters to be read
+    void sim_input(const std::string &s) { rx.erase(0, rx_pos); rx_pos = 0; rx += s; }
+
+private:
+    std::string rx;
+    size_t rx_pos = 0;
+};
+
+extern HardwareSerial Serial;
+
+// arduino-esp32's ESP object, with the cycle counter running at a pretend 240 MHz off the host clock
+class EspClass {
+public:
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 240; }
+};
+
+extern EspClass ESP;
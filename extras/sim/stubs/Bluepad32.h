@@ -0,0 +1,125 @@
+#pragma once
+
+/*
+ * host stand-in for Bluepad32.  the simulator owns a fixed pool of virtual
+ * gamepads, and feeds them from a script (see sim_hal.cpp and sim_main.cpp).  the getters
+ * match the real Controller API so bbrx code compiles unchanged.
+*/
+
+#include <Arduino.h>
+#include <functional>
+
+#define BP32_MAX_GAMEPADS 4
+
+struct ControllerProperties {
+    uint8_t  btaddr[6];
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint16_t flags;
+};
+
+// raw input state of a virtual gamepad, laid out like Bluepad32's uni_gamepad_t
+struct sim_gamepad_state {
+    uint8_t  dpad = 0;
+    int32_t  axis_x = 0, axis_y = 0, axis_rx = 0, axis_ry = 0;
+    int32_t  brake = 0, throttle = 0;
+    uint16_t buttons = 0;
+    uint8_t  misc_buttons = 0;
+    int32_t  gyro[3] = {0, 0, 0};
+    int32_t  accel[3] = {0, 0, 0};
+    int32_t  delta_x = 0, delta_y = 0, scroll_wheel = 0;
+    uint16_t top_left = 0, top_right = 0, bottom_left = 0, bottom_right = 0, temperature = 0;
+    uint8_t  battery = 255;
+};
+
+// button bits, as per Bluepad32
+#define BUTTON_A        0x0001
+#define BUTTON_B        0x0002
+#define BUTTON_X        0x0004
+#define BUTTON_Y        0x0008
+#define BUTTON_SHOULDER_L 0x0010
+#define BUTTON_SHOULDER_R 0x0020
+#define BUTTON_TRIGGER_L  0x0040
+#define BUTTON_TRIGGER_R  0x0080
+#define BUTTON_THUMB_L    0x0100
+#define BUTTON_THUMB_R    0x0200
+
+#define MISC_BUTTON_SYSTEM  0x01
+#define MISC_BUTTON_SELECT  0x02
+#define MISC_BUTTON_START   0x04
+#define MISC_BUTTON_CAPTURE 0x08
+
+class Controller {
+public:
+    int32_t  axisX()       const { return state.axis_x; }
+    int32_t  axisY()       const { return state.axis_y; }
+    int32_t  axisRX()      const { return state.axis_rx; }
+    int32_t  axisRY()      const { return state.axis_ry; }
+    int32_t  brake()       const { return state.brake; }
+    int32_t  throttle()    const { return state.throttle; }
+    int32_t  gyroX()       const { return state.gyro[0]; }
+    int32_t  gyroY()       const { return state.gyro[1]; }
+    int32_t  gyroZ()       const { return state.gyro[2]; }
+    int32_t  accelX()      const { return state.accel[0]; }
+    int32_t  accelY()      const { return state.accel[1]; }
+    int32_t  accelZ()      const { return state.accel[2]; }
+    uint8_t  dpad()        const { return state.dpad; }
+    uint16_t buttons()     const { return state.buttons; }
+    uint8_t  miscButtons() const { return state.misc_buttons; }
+    bool a()               const { return state.buttons & BUTTON_A; }
+    bool b()               const { return state.buttons & BUTTON_B; }
+    bool x()               const { return state.buttons & BUTTON_X; }
+    bool y()               const { return state.buttons & BUTTON_Y; }
+    bool l1()              const { return state.buttons & BUTTON_SHOULDER_L; }
+    bool l2()              const { return state.buttons & BUTTON_TRIGGER_L; }
+    bool r1()              const { return state.buttons & BUTTON_SHOULDER_R; }
+    bool r2()              const { return state.buttons & BUTTON_TRIGGER_R; }
+    bool thumbL()          const { return state.buttons & BUTTON_THUMB_L; }
+    bool thumbR()          const { return state.buttons & BUTTON_THUMB_R; }
+    bool miscSystem()      const { return state.misc_buttons & MISC_BUTTON_SYSTEM; }
+    bool miscSelect()      const { return state.misc_buttons & MISC_BUTTON_SELECT; }
+    bool miscStart()       const { return state.misc_buttons & MISC_BUTTON_START; }
+    bool miscCapture()     const { return state.misc_buttons & MISC_BUTTON_CAPTURE; }
+    int32_t  deltaX()      const { return state.delta_x; }
+    int32_t  deltaY()      const { return state.delta_y; }
+    int32_t  scrollWheel() const { return state.scroll_wheel; }
+    uint16_t topLeft()     const { return state.top_left; }
+    uint16_t topRight()    const { return state.top_right; }
+    uint16_t bottomLeft()  const { return state.bottom_left; }
+    uint16_t bottomRight() const { return state.bottom_right; }
+    uint16_t temperature() const { return state.temperature; }
+    uint8_t  battery()     const { return state.battery; }
+
+    bool isConnected()     const { return connected; }
+    bool hasData()         const { return has_data; }
+    int  index()           const { return idx; }
+
+    String getModelName() const { return String("bbrx sim gamepad"); }
+    ControllerProperties getProperties() const { return ControllerProperties{{0xBB, 0x00, 0x00, 0x00, 0x00, (uint8_t) idx}, 0xBB00, 0x0001, 0}; }
+
+    void setColorLED(uint8_t r, uint8_t g, uint8_t b);
+    void setPlayerLEDs(uint8_t leds);
+    void playDualRumble(uint16_t delayed_start_ms, uint16_t duration_ms, uint8_t weak_magnitude, uint8_t strong_magnitude);
+    void disconnect();
+
+    // simulator side
+    sim_gamepad_state state;
+    bool connected = false;
+    bool has_data = false;
+    int  idx = 0;
+};
+
+typedef Controller *ControllerPtr;
+
+typedef void (*GamepadCallback)(ControllerPtr ctl);
+
+class Bluepad32 {
+public:
+    const char *firmwareVersion() const { return "bbrx-sim"; }
+    void setup(const GamepadCallback &on_connect, const GamepadCallback &on_disconnect);
+    bool update();
+    void forgetBluetoothKeys() {}
+    void enableNewBluetoothConnections(bool enabled) { (void) enabled; }
+};
+
+extern Bluepad32 BP32;
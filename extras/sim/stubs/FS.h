@@ -0,0 +1,52 @@
+#pragma once
+
+/*
+ * host stand-in for arduino-esp32's fs::FS.  files are read from a directory on
+ * the host, which the simulator points at a config directory.
+*/
+
+#include <Arduino.h>
+#include <memory>
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+class FSImpl;
+typedef std::shared_ptr<FSImpl> FSImplPtr;
+
+class File {
+public:
+    File(FILE *f = nullptr, std::string path = "") : f(f, [](FILE *p) { if (p) fclose(p); }), file_path(path) {}
+    explicit operator bool() const { return (bool) f; }
+    size_t size() const;
+    int  available();
+    int  read();
+    void close() { f.reset(); }
+    bool isDirectory() const { return false; }
+    File openNextFile() { return File(); }
+    const char *name() const { return file_path.c_str(); }
+    const char *path() const { return file_path.c_str(); }
+
+private:
+    std::shared_ptr<FILE> f;
+    std::string file_path;
+};
+
+class FS {
+public:
+    FS() {}
+    FS(FSImplPtr impl) : impl(impl) {}
+    File open(const char *path, const char *mode = "r");
+    void set_root(const std::string &dir) { root = dir; }
+
+protected:
+    FSImplPtr impl;
+    std::string root = ".";
+};
+
+} // namespace fs
+
+using fs::File;
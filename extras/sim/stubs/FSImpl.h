@@ -0,0 +1,17 @@
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+
+class FileImpl {
+public:
+    virtual ~FileImpl() {}
+};
+
+class FSImpl {
+public:
+    virtual ~FSImpl() {}
+};
+
+} // namespace fs
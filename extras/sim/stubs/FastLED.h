@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+ * host stand-in for FastLED.  only the colour type, the controller singleton and
+ * the handful of helpers used by status_led.cpp are provided.
+*/
+
+#include <Arduino.h>
+
+struct CRGB {
+    uint8_t r = 0, g = 0, b = 0;
+    CRGB() {}
+    CRGB(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
+    CRGB(uint32_t colour) : r((colour >> 16) & 0xFF), g((colour >> 8) & 0xFF), b(colour & 0xFF) {}
+    enum HTMLColorCode : uint32_t {
+        Black = 0x000000,
+        White = 0xFFFFFF,
+        Red   = 0xFF0000,
+        Green = 0x008000,
+        Blue  = 0x0000FF,
+        Cyan  = 0x00FFFF,
+    };
+};
+
+template<uint8_t DATA_PIN> class NEOPIXEL {};
+
+class CFastLED {
+public:
+    template<template<uint8_t> class CHIPSET, uint8_t DATA_PIN>
+    void addLeds(CRGB *leds, int count) { (void) leds; (void) count; }
+    void setBrightness(uint8_t b) { brightness = b; }
+    uint8_t getBrightness() const { return brightness; }
+    void show() { shows++; }
+
+    uint8_t brightness = 255;
+    unsigned long shows = 0;
+};
+
+extern CFastLED FastLED;
+
+inline uint8_t quadwave8(uint8_t in) {
+    return (uint8_t) ((1.0 - cos(in * 2.0 * M_PI / 256.0)) * 127.5);
+}
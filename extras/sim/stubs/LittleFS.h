@@ -0,0 +1,18 @@
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+public:
+    bool begin(bool format_on_fail = false, const char *base_path = "/littlefs", uint8_t max_open_files = 10, const char *partition_label = "spiffs") {
+        (void) format_on_fail; (void) base_path; (void) max_open_files; (void) partition_label;
+        return true;
+    }
+    void end() {}
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
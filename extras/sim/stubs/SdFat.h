@@ -0,0 +1,36 @@
+#pragma once
+
+/*
+ * host stand-in for SdFat.  the simulator never enables CONFIG_ENABLE_SD, so this
+ * only needs enough of the API for sd_fat32_fs_wrapper.h to compile.
+*/
+
+#include <Arduino.h>
+#include <fcntl.h>
+
+typedef int oflag_t;
+
+class FsFile {
+public:
+    size_t write(const uint8_t *buf, size_t size) { (void) buf; (void) size; return 0; }
+    int  read(uint8_t *buf, size_t size) { (void) buf; (void) size; return 0; }
+    void flush() {}
+    bool seek(uint32_t pos) { (void) pos; return false; }
+    uint32_t curPosition() const { return 0; }
+    uint32_t size() const { return 0; }
+    void close() {}
+    size_t getName(char *name, size_t len) { if (len) name[0] = 0; return 0; }
+    bool isDirectory() const { return false; }
+    FsFile openNextFile(oflag_t flags = O_RDONLY) { (void) flags; return FsFile(); }
+    explicit operator bool() const { return false; }
+};
+
+class SdFat {
+public:
+    FsFile open(const char *path, oflag_t flags) { (void) path; (void) flags; return FsFile(); }
+    bool exists(const char *path)               { (void) path; return false; }
+    bool rename(const char *from, const char *to) { (void) from; (void) to; return false; }
+    bool remove(const char *path)               { (void) path; return false; }
+    bool mkdir(const char *path)                { (void) path; return false; }
+    bool rmdir(const char *path)                { (void) path; return false; }
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+/*
+ * host stand-in for esp-idf's error codes
+*/
+
+typedef int esp_err_t;
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
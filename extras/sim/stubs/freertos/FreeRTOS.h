@@ -0,0 +1,23 @@
+#pragma once
+
+/*
+ * host stand-in for the parts of FreeRTOS used by bbrx.  each task runs as a host
+ * thread, and one FreeRTOS tick is one millisecond.
+*/
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE          1
+#define pdFALSE         0
+#define pdPASS          pdTRUE
+#define pdFAIL          pdFALSE
+#define errQUEUE_FULL   0
+#define portMAX_DELAY   ((TickType_t) 0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms))
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY  0x7FFFFFFF
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+struct sim_task;
+typedef sim_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t   ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t timeout);
@@ -0,0 +1,171 @@
+/*
+ * known-answer checks of the DShot encoder in esc_output.cpp
+ *
+ * checks the throttle values pulse widths are turned into, the frames (and checksums) built from
+ * them, and the RMT items each frame is sent as at every DShot bitrate.  this test has its own
+ * stand-ins for the LEDC and RMT drivers rather than using the simulator's, so it can look at the
+ * exact items esc_output_flush() hands to the driver.
+ *
+ * usage: dshot_test
+ *
+ * exits with 0 if every check passed, or 1 if any failed.
+*/
+
+#include <cstdio>
+#include <cstdint>
+#include <Arduino.h>
+#include <driver/ledc.h>
+#include <driver/rmt.h>
+#include "esc_output.h"
+#include "config.h"
+
+HardwareSerial Serial;
+
+static uint32_t checks = 0;
+static uint32_t failures = 0;
+static const char *context = "";                    // what's being tested, for the failure messages
+
+#define CHECK(what, actual, expected) check(what, (int64_t) (actual), (int64_t) (expected), __LINE__)
+
+static void check(const char *what, int64_t actual, int64_t expected, int line) {
+    checks++;
+    if (actual == expected) return;
+    failures++;
+    printf("FAIL line %d: %s%s is %lld (0x%llx), expected %lld (0x%llx)\n", line, context, what,
+        (long long) actual, (unsigned long long) actual, (long long) expected, (unsigned long long) expected);
+}
+
+//-------------------------------------------
+// driver stand-ins
+//-------------------------------------------
+// the LEDC driver just has to succeed.  the RMT driver keeps the last items written (to any channel)
+
+static rmt_item32_t rmt_items[16];
+static int rmt_item_count = 0;
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf) { return ESP_OK; }
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf) { return ESP_OK; }
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty) { return ESP_OK; }
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel) { return ESP_OK; }
+esp_err_t ledc_stop(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t idle_level) { return ESP_OK; }
+
+esp_err_t rmt_config(const rmt_config_t *rmt_param) { return ESP_OK; }
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags) { return ESP_OK; }
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel) { return ESP_OK; }
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *rmt_item, int item_num, bool wait_tx_done) {
+    rmt_item_count = item_num;
+    for (int i = 0; i < item_num && i < 16; i++) rmt_items[i] = rmt_item[i];
+    return ESP_OK;
+}
+
+//-------------------------------------------
+// tests
+//-------------------------------------------
+
+/**
+ * @brief Check the throttle values at the ends and in the middle of the pulse width range
+ */
+static void test_throttle() {
+    CHECK("throttle below ESC_PWM_MIN", dshot_throttle(ESC_PWM_MIN - 100), 0);
+    CHECK("throttle at ESC_PWM_MIN", dshot_throttle(ESC_PWM_MIN), 0);
+    CHECK("throttle just above ESC_PWM_MIN", dshot_throttle(ESC_PWM_MIN + 1), 50);
+    CHECK("throttle at ESC_PWM_MID", dshot_throttle(ESC_PWM_MID), 1048);
+    CHECK("throttle just below ESC_PWM_MAX", dshot_throttle(ESC_PWM_MAX - 1), 2045);
+    CHECK("throttle at ESC_PWM_MAX", dshot_throttle(ESC_PWM_MAX), 2047);
+    CHECK("throttle above ESC_PWM_MAX", dshot_throttle(ESC_PWM_MAX + 100), 2047);
+
+    // every pulse width in between gives a throttle value, and they never go down
+    uint16_t last = 0;
+    for (int32_t us = ESC_PWM_MIN + 1; us <= ESC_PWM_MAX; us++) {
+        uint16_t throttle = dshot_throttle(us);
+        if (throttle < 48 || throttle > 2047 || throttle < last) CHECK("throttle in range and increasing", throttle, last);
+        last = throttle;
+    }
+}
+
+/**
+ * @brief Check some frames worked out by hand, and the checksum of every frame
+ */
+static void test_frames() {
+    CHECK("frame of zero throttle", dshot_frame(0, false), 0x0000);
+    CHECK("frame of throttle 48", dshot_frame(48, false), 0x0606);
+    CHECK("frame of throttle 1046", dshot_frame(1046, false), 0x82C6);
+    CHECK("frame of throttle 2047", dshot_frame(2047, false), 0xFFEE);
+    CHECK("frame of throttle 2047 with telemetry", dshot_frame(2047, true), 0xFFFF);
+    CHECK("frame of command 1 with telemetry", dshot_frame(1, true), 0x0033);
+
+    // the checksum is the xor of the three data nibbles, so all four nibbles xor to zero
+    for (uint16_t value = 0; value <= 2047; value++) {
+        for (bool telemetry : {false, true}) {
+            uint16_t frame = dshot_frame(value, telemetry);
+            CHECK("frame data", frame >> 4, (value << 1) | telemetry);
+            CHECK("frame checksum", (frame ^ (frame >> 4) ^ (frame >> 8) ^ (frame >> 12)) & 0x0F, 0);
+        }
+    }
+}
+
+/**
+ * @brief Check the RMT items a frame is sent as, at each bitrate
+ *
+ * The RMT counts 80 MHz (12.5ns) ticks.  The bit lengths are 6.67, 3.33 and 1.67µs, a 1 is high
+ * for 3/4 of the bit (5.00, 2.50 and 1.25µs), and a 0 for 3/8 (2.50, 1.25 and 0.625µs).
+ */
+static void test_items() {
+
+    struct {
+        bb_protocol protocol;
+        const char *name;
+        uint16_t    bit;            // expected ticks per bit
+        uint16_t    one;            // expected ticks a 1 is high for
+        uint16_t    zero;           // expected ticks a 0 is high for
+    } rates[] = {
+        {BB_PROTOCOL_DSHOT150, "DShot150", 533, 400, 200},
+        {BB_PROTOCOL_DSHOT300, "DShot300", 267, 200, 100},
+        {BB_PROTOCOL_DSHOT600, "DShot600", 133, 100, 50},
+    };
+
+    // one channel is switched between the bitrates, so the timings are worked out again each time.
+    // full throttle (0xFFEE) has both kinds of bit in it
+    const uint16_t frame = 0xFFEE;
+    if (!esc_output_attach(0, 12, BB_PROTOCOL_DSHOT150)) CHECK("channel attached", 0, 1);
+    for (const auto &rate : rates) {
+        context = rate.name;
+        if (!esc_output_set_protocol(0, rate.protocol)) {
+            CHECK(" protocol set", 0, 1);
+            continue;
+        }
+        rmt_item_count = 0;
+        esc_output_write(0, ESC_PWM_MAX);
+        esc_output_flush();
+
+        CHECK(" number of items", rmt_item_count, 16);
+        for (uint8_t bit = 0; bit < 16; bit++) {
+            const rmt_item32_t &item = rmt_items[bit];
+            bool one = frame & (0x8000 >> bit);
+            CHECK(" item high level", item.level0, 1);
+            CHECK(" item low level", item.level1, 0);
+            CHECK(" item high ticks", item.duration0, one ? rate.one : rate.zero);
+            CHECK(" item low ticks", item.duration1, rate.bit - (one ? rate.one : rate.zero));
+        }
+
+        // zero throttle is all 0 bits
+        esc_output_write(0, ESC_PWM_MIN);
+        esc_output_flush();
+        for (uint8_t bit = 0; bit < 16; bit++) {
+            CHECK(" zero throttle item high ticks", rmt_items[bit].duration0, rate.zero);
+            CHECK(" zero throttle item low ticks", rmt_items[bit].duration1, rate.bit - rate.zero);
+        }
+    }
+    context = "";
+}
+
+int main() {
+
+    test_throttle();
+    test_frames();
+    test_items();
+
+    printf("%lu checks, %lu failed\n", (unsigned long) checks, (unsigned long) failures);
+    return failures ? 1 : 0;
+}
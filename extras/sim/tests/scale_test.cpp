@@ -0,0 +1,109 @@
+/*
+ * checks that scale_apply() gives exactly the same result as map()
+ *
+ * every input in the fixed-point window (and a little way past it) is checked for a set of
+ * ranges like the ones bbrx uses, and every input is checked for every small range, including
+ * empty (in_min == in_max) and reversed ones.  random ranges and inputs cover everything else,
+ * including ranges too big for the fixed-point path (up to ±2^30, so map() itself doesn't overflow).
+ *
+ * usage: scale_test
+ *
+ * exits with 0 if every check passed, or 1 if any failed.
+*/
+
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include "scale.h"
+#include "config.h"
+
+#define SMALL_RANGE         12          // every range with all of its ends within ±this is checked
+#define RANDOM_RANGES       200000      // number of random ranges to check
+#define RANDOM_INPUTS       64          // number of random inputs to check for each random range
+
+static uint64_t checks = 0;
+static uint64_t failures = 0;
+
+/**
+ * @brief Check the result of scale_apply() for one input against map()
+ */
+static inline void check(const bb_scale &s, int32_t x) {
+    long expected = map(x, s.in_min, s.in_max, s.out_min, s.out_max);
+    if (expected < INT32_MIN || expected > INT32_MAX) return;   // results which don't fit aren't defined
+    int32_t actual = scale_apply(s, x);
+    checks++;
+    if (actual == expected) return;
+    if (failures++ < 20) {
+        printf("FAIL scale (%d, %d) -> (%d, %d) of %d is %d, map() gives %d\n",
+            s.in_min, s.in_max, s.out_min, s.out_max, x, actual, (int32_t) expected);
+    }
+}
+
+/**
+ * @brief Check every input in the fixed-point window of a range, and a little past it on each side
+ */
+static void check_window(int32_t in_min, int32_t in_max, int32_t out_min, int32_t out_max) {
+    bb_scale s = scale_make(in_min, in_max, out_min, out_max);
+    int64_t from = (int64_t) in_min - (1 << SCALE_INPUT_BITS) - 16;
+    int64_t to   = (int64_t) in_min + (1 << SCALE_INPUT_BITS) + 16;
+    for (int64_t x = from; x <= to; x++) check(s, (int32_t) x);
+}
+
+/**
+ * @brief Check every input of a range (and a little past each end)
+ */
+static void check_range(int32_t in_min, int32_t in_max, int32_t out_min, int32_t out_max) {
+    bb_scale s = scale_make(in_min, in_max, out_min, out_max);
+    int32_t lo = min(in_min, in_max) - 16;
+    int32_t hi = max(in_min, in_max) + 16;
+    for (int32_t x = lo; x <= hi; x++) check(s, x);
+}
+
+int main() {
+
+    // the whole fixed-point window of the sorts of ranges bbrx uses: stick, trigger and mixer
+    // inputs to pulse widths (both ways round), curves, speed set and feedback
+    const int32_t inputs[][2] = {{-512, 511}, {511, -512}, {0, 1023}, {1023, -1024}, {-4096, 4096}, {0, 1}, {-32768, 32767}};
+    const int32_t outputs[][2] = {{ESC_PWM_MIN, ESC_PWM_MAX}, {ESC_PWM_MAX, ESC_PWM_MIN}, {ESC_PWM_MIN + 250, ESC_PWM_MAX - 250},
+                                  {ESC_PWM_MIN, ESC_PWM_MAX - 499}, {-4096, 4096}, {0, 255}, {0, 500}, {3, 3}};
+    for (const auto &in : inputs) {
+        for (const auto &out : outputs) check_window(in[0], in[1], out[0], out[1]);
+    }
+
+    // every speed limit, for the stick and mixer ranges
+    for (int32_t limit = 0; limit <= (ESC_PWM_MAX - ESC_PWM_MIN) / 2; limit++) {
+        check_range(-512, 511, ESC_PWM_MIN + limit, ESC_PWM_MAX - limit);
+        check_range(-4096, 4096, ESC_PWM_MIN + limit, ESC_PWM_MAX - limit);
+        check_range(0, 1023, ESC_PWM_MIN, ESC_PWM_MAX - limit);
+    }
+
+    // every small range, including empty and reversed ones
+    for (int32_t in_min = -SMALL_RANGE; in_min <= SMALL_RANGE; in_min++) {
+        for (int32_t in_max = -SMALL_RANGE; in_max <= SMALL_RANGE; in_max++) {
+            for (int32_t out_min = -SMALL_RANGE; out_min <= SMALL_RANGE; out_min++) {
+                for (int32_t out_max = -SMALL_RANGE; out_max <= SMALL_RANGE; out_max++) {
+                    check_range(in_min, in_max, out_min, out_max);
+                }
+            }
+        }
+    }
+
+    // random ranges of every size, with inputs anywhere (and at the edges of the window)
+    std::mt19937 rng(1);
+    for (uint32_t i = 0; i < RANDOM_RANGES; i++) {
+        int bits = rng() % 31;
+        int32_t span = (int32_t) (1u << bits);
+        auto value = [&]() { return (int32_t) ((int64_t) (rng() % (2 * (uint64_t) span + 1)) - span); };
+        bb_scale s = scale_make(value(), value(), value(), value());
+        for (uint32_t j = 0; j < RANDOM_INPUTS; j++) check(s, value());
+        const int64_t edges[] = {s.in_min, s.in_max, (int64_t) s.in_min - (1 << SCALE_INPUT_BITS), (int64_t) s.in_min + (1 << SCALE_INPUT_BITS)};
+        for (int64_t edge : edges) {
+            for (int64_t x = edge - 2; x <= edge + 2; x++) {
+                if (x >= INT32_MIN && x <= INT32_MAX) check(s, (int32_t) x);
+            }
+        }
+    }
+
+    printf("%llu checks, %llu failed\n", (unsigned long long) checks, (unsigned long long) failures);
+    return failures ? 1 : 0;
+}